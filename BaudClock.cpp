@@ -0,0 +1,101 @@
+//**********************************************************************
+//
+// BaudClock, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#include "Arduino.h"
+#include "BaudClock.h"
+
+#define BAUD_PRESCALE 8
+#define STEPS_PER_SEC (F_CPU / BAUD_PRESCALE)
+
+// A half bit is STEPS_PER_SEC / (2 * baud) steps, or with baud in
+// hundredths 100 * STEPS_PER_SEC / (2 * baud100)
+#define HALF_BIT_NUM (STEPS_PER_SEC * 50)
+
+static_assert(HALF_BIT_NUM / MIN_BAUD100 < 65535UL, "MIN_BAUD100 too low for Timer1");
+
+BaudClock::BaudClock(byte channel)
+{
+	_channel = channel;
+	_whole = 0;
+	_frac = 0;
+	_den = 1;
+	_acc = 0;
+}
+
+// The first half bit starts now.  Timer1 is set up again each time,
+// which leaves its count, and so the other channel, undisturbed.
+void BaudClock::begin(unsigned int baud100)
+{
+	uint8_t sreg = SREG;
+	cli();
+	_whole = HALF_BIT_NUM / baud100;
+	_frac = HALF_BIT_NUM % baud100;
+	_den = baud100;
+	_acc = 0;
+	TCCR1A = 0;
+	TCCR1B = _BV(CS11);                 // normal mode, clk/8
+	if (_channel) {
+		OCR1B = TCNT1 + _whole;
+		TIFR1 = _BV(OCF1B);
+		TIMSK1 |= _BV(OCIE1B);
+	} else {
+		OCR1A = TCNT1 + _whole;
+		TIFR1 = _BV(OCF1A);
+		TIMSK1 |= _BV(OCIE1A);
+	}
+	SREG = sreg;
+}
+
+// The next compare is one half bit after the one that has just
+// matched, however late the interrupt runs, short of a half bit
+void BaudClock::step()
+{
+	unsigned int n = _whole;
+	_acc += _frac;
+	if (_acc >= _den) {
+		_acc -= _den;
+		n++;
+	}
+	if (_channel)
+		OCR1B += n;
+	else
+		OCR1A += n;
+}
+
+float BaudClock::rate()
+{
+	float steps = _whole + (float)_frac / _den;
+	return STEPS_PER_SEC / (2 * steps);
+}
+
+unsigned long BaudClock::half_bit_usec()
+{
+	return ((unsigned long)_whole * BAUD_PRESCALE + F_CPU / 2000000L) / (F_CPU / 1000000L);
+}
+
+unsigned long BaudClock::half_bit_clocks()
+{
+	return (unsigned long)_whole * BAUD_PRESCALE + (_frac ? BAUD_PRESCALE : 0);
+}
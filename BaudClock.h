@@ -0,0 +1,66 @@
+//**********************************************************************
+//
+// BaudClock, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef BaudClock_h
+#define BaudClock_h
+
+#include "Arduino.h"
+#include "constants.h"
+
+// Timer1 interrupt every half bit of FSK, one compare unit per channel:
+// OCR1A and TIMER1_COMPA_vect for channel 0, OCR1B and TIMER1_COMPB_vect
+// for channel 1.
+//
+// Timer1 runs free in 0.5 usec steps (clk/8) and step(), called from
+// the compare interrupt, moves the compare on by one half bit, so two
+// channels keep their own rates on the one counter and the time the
+// interrupt takes to run never adds up.  A half bit is rarely a whole
+// number of steps, 22002.2 at 45.45 baud, so each is the whole part or
+// one more, as a phase accumulator of the fraction comes due.  Each
+// edge is then within one step of its ideal time and the long run rate
+// is exact to the crystal, whatever the rate: MIN_BAUD100 to
+// MAX_BAUD100 in hundredths of a baud.
+
+class BaudClock
+{
+public:
+	BaudClock(byte channel = 0);
+
+	void begin(unsigned int baud100);  // program Timer1 and start
+	void step();                       // from the compare interrupt
+
+	float rate();                      // achieved baud
+	unsigned long half_bit_usec();     // nearest whole usec
+	unsigned long half_bit_clocks();   // CPU clocks, rounded up
+
+private:
+	byte _channel;         // compare unit A or B
+	unsigned int _whole;   // steps per half bit
+	unsigned int _frac;    // and the fraction, in 1/_den
+	unsigned int _den;
+	unsigned int _acc;     // fraction owed, in 1/_den
+};
+
+#endif
@@ -0,0 +1,55 @@
+//**********************************************************************
+//
+// CWTiming, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#include "Arduino.h"
+#include "CWTiming.h"
+
+// The weighting keeps the dash/dot ratio at weight / 100 the way the
+// original float code did,
+//   dot  = 2 * unit / (ratio - 1)
+//   dash = 2 * unit * ratio / (ratio - 1)
+// which gives 1 and 3 units at the nominal 3.00.  The largest product,
+// 240000 usec * 700 at 5 WPM, is well inside an unsigned long.
+void CWTiming::set(int wpm, int weight, int fwpm)
+{
+	unsigned long unit = 1200000UL / wpm;
+
+	dot = unit * 200 / (weight - 100);
+	dash = unit * 2 * weight / (weight - 100);
+	space = unit;
+
+	if (fwpm > 0 && fwpm < wpm) {
+// total added delay per word  ta = 60 / fwpm - 37.2 / wpm seconds,
+// of which 3/19 goes to each letter gap and 7/19 to the word gap
+		unsigned long ta = 60000000UL / fwpm - 37200000UL / wpm;
+		unsigned long tc = 3 * ta / 19;
+		unsigned long tw = 7 * ta / 19;
+		letter = tc - space;
+		word = tw - tc;
+	} else {
+		letter = 2 * unit;
+		word = 4 * unit;
+	}
+}
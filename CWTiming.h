@@ -0,0 +1,57 @@
+//**********************************************************************
+//
+// CWTiming, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef CWTiming_h
+#define CWTiming_h
+
+#include "Arduino.h"
+
+// Morse element and gap lengths in microseconds, shared by Morse
+// (buffered text) and Keyer (paddles).
+//
+// Speed is in WPM on PARIS, so one unit is 1200000 / wpm usec.  Weight
+// is the dash/dot ratio in hundredths, 250 to 350, 300 nominal.  It is
+// all long integer arithmetic: a speed or weight change costs a few
+// divides and no float code.
+//
+// A Farnsworth (overall) speed below the character speed stretches the
+// letter and word gaps, per the ARRL formula, so the text as a whole
+// comes out at the overall speed.  0 turns Farnsworth spacing off.
+
+class CWTiming
+{
+public:
+	unsigned long dot;      // key down for a dit
+	unsigned long dash;     // key down for a dah
+	unsigned long space;    // key up after every element
+	unsigned long letter;   // further key up at the end of a character
+	unsigned long word;     // further key up for a word space
+
+	CWTiming() {}
+	CWTiming(int wpm, int weight, int fwpm = 0) { set(wpm, weight, fwpm); }
+	void set(int wpm, int weight, int fwpm = 0);
+};
+
+#endif
@@ -0,0 +1,108 @@
+//**********************************************************************
+//
+// Channel, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+
+#ifndef Channel_h
+#define Channel_h
+
+#include "Arduino.h"
+#include "constants.h"
+#include "Morse.h"
+#include "PttSequencer.h"
+#include "SendBuffer.h"
+#include "BaudClock.h"
+#include "Telemetry.h"
+
+// CW settings of a channel
+struct CWSettings {
+	int cw_wpm = 18;
+	int weight = 300;     // dash/dot ratio in hundredths
+	int incr = 2;
+	int key_wpm = 18;     // for the paddles while they key this channel
+	int farns_wpm = 0;    // Farnsworth overall wpm, 0 = off
+};
+
+// The CW settings as earlier versions saved them at EE_CW_STRUC_ADDR,
+// laid out as on the AVR.  eeLoad() converts them when no configuration
+// record has been saved.
+struct LegacyCWStruc {
+	int16_t cw_wpm;
+	float   weight;       // dash/dot ratio
+	int16_t incr;
+	int16_t key_wpm;
+} __attribute__((packed));
+
+// Everything one radio transmits with: its mode and settings, send
+// buffer, PTT sequencer, the Morse generator for buffered CW and the
+// state of the FSK character being clocked out.  Channel n drives the
+// lines in KeyLines.h and, for FSK, compare unit n of Timer1, so the
+// half bits of one channel never wait on the other.  The sketch keeps
+// CHANNELS of them.
+
+struct Channel {
+	Channel(byte channel) :
+		n(channel),
+		morse(cw.cw_wpm, cw.weight, channel),
+		pttSeq(channel),
+		baudClock(channel) {}
+
+	byte n;
+	int mode = DEFAULT_MODE;
+	CWSettings cw;
+	Morse morse;
+
+	PttSequencer pttSeq;
+	int pttLeadMillis = PTT_LEAD_MS;  // time before the first keying edge
+	int pttTailMillis = PTT_TAIL_MS;  // time after the host ends a transmission
+	int pttHangMillis = PTT_HANG_MS;  // time after the last CW element
+	boolean ptt = false;              // the host has the transmitter on
+	volatile boolean tuneKey = false; // ~T: key CW once PTT is ready
+
+	SendBuffer sendBuffer;            // unsent TX text, Baudot in FSK
+	boolean endWhenBufferEmpty = true; // drop PTT when the buffer empties (']')
+
+	// FSK, set by user commands
+	unsigned int baud100 = DEFAULT_BAUD100;  // baud * 100
+	volatile byte stopBits = STOP_BITS_1R5;  // ~Zn
+	byte usos = USOS_MMTTY_HACK;  // ~$n, shifts queued with the text
+	boolean mark = LOW;       // High indicates +V on the FSK/CW pin
+	boolean space = HIGH;
+	BaudClock baudClock;      // every half bit at that rate
+	unsigned long halfBitMicros;
+	TickCounter halfBits;     // for the runtime report
+
+	// FSK, while sending; see processHalfBit()
+	volatile byte currentShiftState = SHIFT_UNKNOWN;  // once the staged character has gone
+	volatile byte stagedChar = FSK_EMPTY;  // next Baudot character for the half-bit interrupt
+	byte encShiftState = SHIFT_UNKNOWN;    // once everything in the buffer has gone
+	byte encLastCode = LTRS_SHIFT;         // last code queued, for the MMTTY style USOS check
+	volatile boolean txEndReached = false; // the interrupt has reached TX_END_FLAG
+	int sendingChar = LTRS_SHIFT;
+	int stopBitCounter = 0;   // half bits left of the stop bit
+	int bitPos = START_BIT_POS;
+	bool midBit = false;      // the second half of a data or start bit is next
+};
+
+#endif
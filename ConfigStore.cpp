@@ -0,0 +1,134 @@
+//**********************************************************************
+//
+// ConfigStore, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "ConfigStore.h"
+
+static_assert(CONFIG_SLOTS >= 2 && CONFIG_SLOTS < 128, "bad configuration region");
+
+ConfigStore::ConfigStore()
+{
+	memset(&_rec, 0, sizeof(_rec));
+	_slot = CONFIG_SLOTS - 1;   // so the first save goes to slot 0
+	_pos = sizeof(ConfigRecord);
+	_seen = 0;
+	_seenMillis = 0;
+}
+
+// CRC-16/CCITT of a record up to its crc field
+uint16_t ConfigStore::crc(const void *r, byte len)
+{
+	const byte *p = (const byte *)r;
+	uint16_t c = 0xFFFF;
+	for (byte i = 0; i < len; i++) {
+		c ^= (uint16_t)p[i] << 8;
+		for (byte b = 0; b < 8; b++)
+			c = (c & 0x8000) ? (c << 1) ^ 0x1021 : c << 1;
+	}
+	return c;
+}
+
+// Same settings, whatever the sequence number
+bool ConfigStore::same(const ConfigRecord &a, const ConfigRecord &b)
+{
+	return memcmp(&a.version, &b.version,
+		offsetof(ConfigRecord, crc) - offsetof(ConfigRecord, version)) == 0;
+}
+
+// Finds the newest valid record.  Sequence numbers of valid records
+// are never more than CONFIG_SLOTS apart, so they are compared modulo
+// 256.  Only reads the EEPROM.
+bool ConfigStore::load(ConfigRecord &r)
+{
+	ConfigRecord t;
+	bool found = false;
+
+	for (byte i = 0; i < CONFIG_SLOTS; i++) {
+		EEPROM.get(addr(i), t);
+		if (t.version != CONFIG_VERSION || t.crc != crc(t))
+			continue;
+		if (!found || (int8_t)(t.seq - _rec.seq) > 0) {
+			_rec = t;
+			_slot = i;
+			found = true;
+		}
+	}
+	if (found) {
+		r = _rec;
+		update(r);
+	}
+	return found;
+}
+
+unsigned int ConfigStore::legacy_baud(byte c)
+{
+	switch (c) {
+		case COMMAND_50BAUD :  return 5000;
+		case COMMAND_75BAUD :  return 7500;
+		case COMMAND_100BAUD : return 10000;
+		default :              return DEFAULT_BAUD100;
+	}
+}
+
+void ConfigStore::update(const ConfigRecord &r)
+{
+	ConfigRecord t = r;
+	t.seq = 0;
+	t.version = CONFIG_VERSION;
+	uint16_t c = crc(t);
+
+	if (c != _seen) {                 // changed since last time
+		_seen = c;
+		_seenMillis = millis();
+		return;
+	}
+	if (same(t, _rec) || busy())
+		return;
+	if (millis() - _seenMillis >= CONFIG_QUIET_MILLIS)
+		save(r);
+}
+
+// Starts writing r to the next slot now.  A write still in progress
+// is abandoned; its slot fails the CRC check and is skipped.
+void ConfigStore::save(const ConfigRecord &r)
+{
+	byte seq = _rec.seq + 1;
+	_rec = r;
+	_rec.seq = seq;
+	_rec.version = CONFIG_VERSION;
+	_rec.crc = crc(_rec);
+	_slot = (_slot + 1) % CONFIG_SLOTS;
+	_pos = 0;
+}
+
+void ConfigStore::service()
+{
+	const byte *p = (const byte *)&_rec;
+	while (busy() && eeprom_is_ready()) {
+		EEPROM.update(addr(_slot) + _pos, p[_pos]);
+		_pos++;
+	}
+}
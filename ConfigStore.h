@@ -0,0 +1,95 @@
+//**********************************************************************
+//
+// ConfigStore, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef ConfigStore_h
+#define ConfigStore_h
+
+#include "Arduino.h"
+#include "constants.h"
+
+// Saved configuration.  Bump CONFIG_VERSION when the layout changes;
+// records of another version are ignored.
+#define CONFIG_VERSION 1
+
+struct ConfigRecord {
+	byte     seq;         // counts up with each record written
+	byte     version;
+	uint16_t baud100;     // FSK baud * 100
+	byte     stop_bits;   // STOP_BITS_1 ...
+	byte     usos;        // USOS_OFF ...
+	byte     polarity;    // COMMAND_POLARITY_MARK_HIGH / _LOW
+	byte     serial;      // serial speed '1' ...
+	int16_t  cw_wpm;
+	int16_t  weight;
+	int16_t  incr;
+	int16_t  key_wpm;
+	int16_t  farns_wpm;
+	uint16_t contest_nr;
+	uint16_t crc;         // CRC-16 of everything above
+} __attribute__((packed));
+
+// Wear levelled configuration records in EEPROM.
+//
+// Each save goes to the slot after the newest one, round the region
+// from EE_CONFIG_ADDR, so every slot is written equally often and the
+// newest record stays intact until its successor is complete.  A
+// record whose CRC does not match (never written, or cut short by a
+// power failure) is skipped when loading.
+//
+// update() is given the current configuration every so often.  Once
+// it differs from what was saved and has then stayed the same for
+// CONFIG_QUIET_MILLIS it is saved.  service() writes the bytes only
+// while the EEPROM is ready, so nothing waits 3.3 msec for a cell to
+// program; bytes that already hold the right value are not rewritten.
+
+class ConfigStore
+{
+public:
+	ConfigStore();
+
+	bool load(ConfigRecord &r);
+	void update(const ConfigRecord &r);
+	void save(const ConfigRecord &r);
+	void service();
+	bool busy() { return _pos < sizeof(ConfigRecord); }
+
+	static unsigned int legacy_baud(byte c);  // COMMAND_45BAUD ... to baud * 100
+
+private:
+	ConfigRecord _rec;      // newest record, saved or being written
+	byte _slot;             // its slot
+	byte _pos;              // next byte of it to write
+	uint16_t _seen;         // CRC of the last configuration given
+	unsigned long _seenMillis;
+
+	static uint16_t crc(const void *p, byte len);
+	static uint16_t crc(const ConfigRecord &r) { return crc(&r, offsetof(ConfigRecord, crc)); }
+	static bool same(const ConfigRecord &a, const ConfigRecord &b);
+	static int addr(byte slot) { return EE_CONFIG_ADDR + slot * sizeof(ConfigRecord); }
+};
+
+#define CONFIG_SLOTS (EE_CONFIG_SIZE / sizeof(ConfigRecord))
+
+#endif
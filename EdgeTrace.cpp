@@ -0,0 +1,188 @@
+//**********************************************************************
+//
+// EdgeTrace, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#include "Arduino.h"
+#include "EdgeTrace.h"
+
+#ifdef EDGE_TRACE
+
+#define TRACE_LINES 3
+#define HIST_LINES  2   // FSK and CW have an ideal period, PTT does not
+
+struct edge_t {
+	unsigned long t;
+	byte line_level;    // line << 1 | level
+};
+
+static edge_t trace_buf[EDGE_TRACE_SIZE];
+static byte trace_next = 0;
+static unsigned int trace_count = 0;
+
+static unsigned long last_t[TRACE_LINES];
+static unsigned long expected[TRACE_LINES];
+static byte last_level[TRACE_LINES];
+
+static unsigned int hist[HIST_LINES][EDGE_HIST_BINS];
+static long max_dev[HIST_LINES];
+
+// Called from the half-bit and CW tick interrupts as well as the main
+// loop, so the bookkeeping is done with interrupts masked.
+void edge_trace(byte line, byte level, unsigned long hold_us)
+{
+	uint8_t sreg = SREG;
+	cli();
+	unsigned long now = micros();
+
+	if (level == last_level[line]) {
+		if (hold_us == 0 || expected[line] == 0)
+			expected[line] = 0;
+		else
+			expected[line] += hold_us;
+		SREG = sreg;
+		return;
+	}
+
+	if (line < HIST_LINES && expected[line]) {
+		long dev = (long)(now - last_t[line] - expected[line]);
+		int bin;
+		if (dev < 0)
+			bin = EDGE_HIST_BINS / 2 - 1 - (-dev - 1) / EDGE_HIST_BIN_US;
+		else
+			bin = EDGE_HIST_BINS / 2 + dev / EDGE_HIST_BIN_US;
+		if (bin < 0) bin = 0;
+		if (bin >= EDGE_HIST_BINS) bin = EDGE_HIST_BINS - 1;
+		hist[line][bin]++;
+		if (labs(dev) > labs(max_dev[line]))
+			max_dev[line] = dev;
+	}
+
+	trace_buf[trace_next].t = now;
+	trace_buf[trace_next].line_level = (line << 1) | (level ? 1 : 0);
+	if (++trace_next == EDGE_TRACE_SIZE)
+		trace_next = 0;
+	if (trace_count < 0xFFFF)
+		trace_count++;
+
+	last_t[line] = now;
+	expected[line] = hold_us;
+	last_level[line] = level;
+	SREG = sreg;
+}
+
+void edge_trace_clear()
+{
+	uint8_t sreg = SREG;
+	cli();
+	trace_next = 0;
+	trace_count = 0;
+	memset(hist, 0, sizeof(hist));
+	memset(max_dev, 0, sizeof(max_dev));
+	memset(expected, 0, sizeof(expected));
+	SREG = sreg;
+}
+
+#define DUMP_EDGES 4    // transitions printed in each part of the dump
+
+static byte dump_first;     // the transitions being dumped
+static byte dump_n;
+
+static void print_line(OutputQueue &out, byte line)
+{
+	if (line == TRACE_FSK)
+		out.print(F("FSK"));
+	else if (line == TRACE_CW)
+		out.print(F("CW"));
+	else
+		out.print(F("PTT"));
+}
+
+/**
+  Prints part of the dump: a heading, the newest transitions, oldest
+  first, DUMP_EDGES at a time, then a deviation histogram a line.
+  Returns true while there is more to come; the loop asks for each
+  part once the one before has gone out, so the dump never waits on
+  the serial port.  Entries are copied out one at a time with
+  interrupts masked; keying carries on meanwhile, so on a busy line
+  the oldest few may already have been replaced by the time they are
+  printed.
+*/
+bool edge_trace_dump(OutputQueue &out, byte part)
+{
+	edge_t e;
+	unsigned int h;
+	long d;
+	byte parts;
+
+	uint8_t sreg = SREG;
+	if (part == 0) {
+		cli();
+		dump_n = trace_count < EDGE_TRACE_SIZE ? trace_count : EDGE_TRACE_SIZE;
+		dump_first = trace_count < EDGE_TRACE_SIZE ? 0 : trace_next;
+		SREG = sreg;
+		out.print(F("\nEdges (usec line level)\n"));
+		return true;
+	}
+	part--;
+	parts = (dump_n + DUMP_EDGES - 1) / DUMP_EDGES;
+	if (part < parts) {
+		for (byte i = part * DUMP_EDGES; i < dump_n && i < (part + 1) * DUMP_EDGES; i++) {
+			cli();
+			e = trace_buf[(dump_first + i) % EDGE_TRACE_SIZE];
+			SREG = sreg;
+			out.print(e.t);
+			out.print(' ');
+			print_line(out, e.line_level >> 1);
+			out.print(e.line_level & 1 ? F(" 1\n") : F(" 0\n"));
+		}
+		return true;
+	}
+
+	byte l = part - parts;
+	if (l == 0) {
+		out.print(F("Deviation, "));
+		out.print(EDGE_HIST_BIN_US);
+		out.print(F(" usec bins from -"));
+		out.print(EDGE_HIST_BIN_US * EDGE_HIST_BINS / 2);
+		out.print('\n');
+	}
+	print_line(out, l);
+	out.print(':');
+	for (byte b = 0; b < EDGE_HIST_BINS; b++) {
+		cli();
+		h = hist[l][b];
+		SREG = sreg;
+		out.print(' ');
+		out.print(h);
+	}
+	cli();
+	d = max_dev[l];
+	SREG = sreg;
+	out.print(F(" max "));
+	out.print(d);
+	out.print('\n');
+	return l + 1 < HIST_LINES;
+}
+
+#endif
@@ -0,0 +1,65 @@
+//**********************************************************************
+//
+// EdgeTrace, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef EdgeTrace_h
+#define EdgeTrace_h
+
+#include "Arduino.h"
+
+#include "config.h"
+#include "OutputQueue.h"
+
+// Keying edge instrumentation, enabled with EDGE_TRACE in config.h.
+//
+// Every write to a keying line is reported with the time the new level
+// is meant to be held for.  Writes that do not change the level just
+// extend that time; on a real transition the micros() timestamp goes
+// into a small ring buffer and the difference between the measured and
+// the ideal length of the level just ended goes into a histogram.
+// A hold time of 0 means "open ended" (PTT, idle key up) and the next
+// transition on that line is recorded but not put in the histogram.
+//
+// With EDGE_TRACE undefined TRACE_EDGE() expands to nothing.
+
+#define TRACE_FSK 0
+#define TRACE_CW  1
+#define TRACE_PTT 2
+
+#ifdef EDGE_TRACE
+
+#define EDGE_TRACE_SIZE 64     // transitions kept, 5 bytes each
+#define EDGE_HIST_BINS  16
+#define EDGE_HIST_BIN_US 16    // bin width; the middle two bins straddle 0
+
+void edge_trace(byte line, byte level, unsigned long hold_us);
+bool edge_trace_dump(OutputQueue &out, byte part);
+void edge_trace_clear();
+
+#  define TRACE_EDGE(line, level, hold_us) edge_trace(line, level, hold_us)
+#else
+#  define TRACE_EDGE(line, level, hold_us)
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+//**********************************************************************
+//
+// FastPin, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef FastPin_h
+#define FastPin_h
+
+#include "Arduino.h"
+
+// Direct port access for pins known at compile time.
+//
+// digitalRead() and digitalWrite() look the port and bit up in flash
+// tables and mask interrupts on every call, several microseconds each.
+// With the pin number as a template argument all of that resolves at
+// compile time: high() and low() become a single sbi / cbi, which is
+// also atomic with respect to interrupts, and read() a single sbis.
+//
+// Pin numbers are those of the ATmega328P Uno / Nano:
+//   D0..D7 PORTD, D8..D13 PORTB, A0..A5 (14..19) PORTC
+
+#define FASTPIN_INLINE inline __attribute__((always_inline))
+
+template <uint8_t PIN>
+class FastPin
+{
+	static_assert(PIN < 20, "not an ATmega328P pin");
+
+public:
+	static const uint8_t mask = _BV(PIN < 8 ? PIN : PIN < 14 ? PIN - 8 : PIN - 14);
+
+	static FASTPIN_INLINE void output() { ddr() |= mask; }
+	static FASTPIN_INLINE void input_pullup() { ddr() &= ~mask; port() |= mask; }
+
+	static FASTPIN_INLINE void high() { port() |= mask; }
+	static FASTPIN_INLINE void low() { port() &= ~mask; }
+	static FASTPIN_INLINE void write(bool v) { if (v) high(); else low(); }
+	static FASTPIN_INLINE bool read() { return (pin() & mask) != 0; }
+
+	// enable the pin change interrupt for this pin: PCINT2_vect for
+	// D0..D7, PCINT0_vect for D8..D13, PCINT1_vect for A0..A5
+	static FASTPIN_INLINE void pcint_enable() { pcmsk() |= mask; PCICR |= pcie; }
+
+private:
+	static const uint8_t pcie = _BV(PIN < 8 ? PCIE2 : PIN < 14 ? PCIE0 : PCIE1);
+
+	static FASTPIN_INLINE volatile uint8_t &port()
+		{ return PIN < 8 ? PORTD : PIN < 14 ? PORTB : PORTC; }
+	static FASTPIN_INLINE volatile uint8_t &ddr()
+		{ return PIN < 8 ? DDRD : PIN < 14 ? DDRB : DDRC; }
+	static FASTPIN_INLINE volatile uint8_t &pin()
+		{ return PIN < 8 ? PIND : PIN < 14 ? PINB : PINC; }
+	static FASTPIN_INLINE volatile uint8_t &pcmsk()
+		{ return PIN < 8 ? PCMSK2 : PIN < 14 ? PCMSK0 : PCMSK1; }
+};
+
+#endif
@@ -0,0 +1,113 @@
+//**********************************************************************
+//
+// KeyLines, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+
+#ifndef KeyLines_h
+#define KeyLines_h
+
+#include "Arduino.h"
+
+#include "config.h"
+#include "constants.h"
+#include "FastPin.h"
+#include "EdgeTrace.h"
+#include "Sidetone.h"
+
+// The FSK, CW and PTT outputs of each channel.
+//
+// Channel 0 is FSK_PIN, CW_PIN and PTT_PIN; in SO2R builds channel 1
+// is FSK2_PIN, CW2_PIN and PTT2_PIN.  The pins are still fixed at
+// compile time, so a write is a test of the channel and a single sbi
+// or cbi; with one channel the test goes as well.  The edge trace
+// records channel 0 only, and the sidetone follows the channel set
+// with SIDETONE_FOLLOW().
+
+typedef FastPin<FSK_PIN> FskPin;
+typedef FastPin<CW_PIN>  CwPin;
+typedef FastPin<PTT_PIN> PttPin;
+#ifdef SO2R
+typedef FastPin<FSK2_PIN> Fsk2Pin;
+typedef FastPin<CW2_PIN>  Cw2Pin;
+typedef FastPin<PTT2_PIN> Ptt2Pin;
+#endif
+
+static inline void key_lines_output()
+{
+	FskPin::output();
+	PttPin::output();
+	CwPin::output();
+#ifdef SO2R
+	Fsk2Pin::output();
+	Ptt2Pin::output();
+	Cw2Pin::output();
+#endif
+}
+
+// hold_us is only for the edge trace: how long this level should last
+static inline void trace_line(byte ch, byte line, bool level, unsigned long hold_us)
+{
+#ifdef EDGE_TRACE
+	if (ch == 0)
+		TRACE_EDGE(line, level, hold_us);
+#else
+	(void)ch; (void)line; (void)level; (void)hold_us;
+#endif
+}
+
+static inline void fsk_line(byte ch, bool level, unsigned long hold_us)
+{
+#ifdef SO2R
+	if (ch)
+		Fsk2Pin::write(level);
+	else
+#endif
+	FskPin::write(level);
+	trace_line(ch, TRACE_FSK, level, hold_us);
+}
+
+static inline void cw_line(byte ch, bool on, unsigned long hold_us)
+{
+#ifdef SO2R
+	if (ch)
+		Cw2Pin::write(on);
+	else
+#endif
+	CwPin::write(on);
+	SIDETONE_KEY(ch, on);
+	trace_line(ch, TRACE_CW, on, hold_us);
+}
+
+static inline void ptt_line(byte ch, bool on)
+{
+#ifdef SO2R
+	if (ch)
+		Ptt2Pin::write(on);
+	else
+#endif
+	PttPin::write(on);
+	trace_line(ch, TRACE_PTT, on, 0);
+}
+
+#endif
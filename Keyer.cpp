@@ -21,10 +21,10 @@
 //======================================================================
 
 #include "Arduino.h"
-#include "TimerOne.h"
 #include "Keyer.h"
-
-//#define ST_Freq 600   // Set the Sidetone Frequency to 600 Hz
+#include "constants.h"
+#include "FastPin.h"
+#include "KeyLines.h"
 
 //======================================================================
 //  keyerControl bit definitions
@@ -37,23 +37,26 @@
 //
 //  State Machine Defines
 
-enum KSTYPE {IDLE, CHK_DIT, CHK_DAH, KEYED_PREP, KEYED, INTER_ELEMENT };
-
-Keyer::Keyer(int wpm, float weight)
-{
-	ptt_pin_ = PTT_PIN;
-	cw_pin_ = CW_PIN;
-// Setup outputs
-	pinMode(LP_in, INPUT);            // sets Left Paddle digital pin as input
-	pinMode(RP_in, INPUT);            // sets Right Paddle digital pin as input
+enum KSTYPE {IDLE, CHK_DIT, CHK_DAH, KEYED, INTER_ELEMENT };
 
-//  pinMode(ST_Pin, OUTPUT);          // Sets the Sidetone digital pin as output
-
-	digitalWrite(LP_in, HIGH);        // Enable pullup resistor on Left Paddle Input Pin
-	digitalWrite(RP_in, HIGH);        // Enable pullup resistor on Right Paddle Input Pin
+typedef FastPin<LP_in>   LeftPaddle;
+typedef FastPin<RP_in>   RightPaddle;
 
+Keyer::Keyer(int wpm, int weight)
+{
+// Setup inputs
+	LeftPaddle::input_pullup();       // Left Paddle input with pullup resistor
+	RightPaddle::input_pullup();      // Right Paddle input with pullup resistor
+	_down = 0;
+	_pressed = 0;
+	_edge[0] = _edge[1] = -(unsigned long)PADDLE_DEBOUNCE_US;
+	LeftPaddle::pcint_enable();       // edges go to paddle_edge()
+	RightPaddle::pcint_enable();
+
+	_channel = 0;
 	keyerState = IDLE;
 	keyerControl = 0;
+	_remain = 0;
 	key_mode = IAMBICA;
   _weight = weight;
 
@@ -64,25 +67,33 @@ Keyer::Keyer(int wpm, float weight)
 // Calculate the length of dot, dash and silence
 void Keyer::calc_ratio()
 {
-  float w = (1 + _weight) / (_weight -1);
-  _space_len = (1200 / _speed);
-  _dotlen = _space_len * (w - 1);
-  _dashlen =  (1 + w) * _space_len;
+  CWTiming t(_speed, _weight);
+
+  uint8_t sreg = SREG;
+  cli();
+  _timing = t;
+  SREG = sreg;
 }
 
-void Keyer::cw_pin(int pin)
+void Keyer::set_mode(int md)
 {
-	ptt_pin_ = pin;
+  key_mode = md;
 }
 
-void Keyer::ptt_pin(int pin)
+// Only while the keyer is idle, with the tick interrupt masked
+void Keyer::set_channel(byte ch)
 {
-	cw_pin_ = pin;
+  _channel = ch;
 }
 
-void Keyer::set_mode(int md)
+bool Keyer::busy()
 {
-  key_mode = md;
+	return keyerState != IDLE;
+}
+
+bool Keyer::active()
+{
+	return keyerState != IDLE || _down || _pressed;
 }
 
 void Keyer::wpm(int wpm)
@@ -90,107 +101,143 @@ void Keyer::wpm(int wpm)
   _speed = wpm;
   calc_ratio();
 }
+
+void Keyer::weight(int wt)
+{
+  _weight = wt;
+  calc_ratio();
+}
+//======================================================================
+//    Paddle edges, from the pin change interrupt
+//======================================================================
+
+// A paddle that differs from its debounced state takes the new state
+// unless it changed less than PADDLE_DEBOUNCE_US ago.  Runs with
+// interrupts off.  tick() calls it as well, for a change that came
+// while the paddle was locked out and so raised no interrupt.
+void Keyer::paddle_edge()
+{
+	unsigned long now = micros();
+	byte raw = 0;
+	if (!RightPaddle::read()) raw |= DIT_L;
+	if (!LeftPaddle::read()) raw |= DAH_L;
+
+	byte changed = raw ^ _down;
+	for (byte i = 0; i < 2; i++) {
+		byte bit = i ? DAH_L : DIT_L;
+		if (!(changed & bit) || now - _edge[i] < PADDLE_DEBOUNCE_US)
+			continue;
+		_edge[i] = now;
+		_down ^= bit;
+		if (raw & bit)
+			_pressed |= bit;
+	}
+}
+
 //======================================================================
 //    Latch paddle press
 //======================================================================
 
+// Paddles held now, and any pressed since the last latch even if
+// already released
 void Keyer::update_PaddleLatch()
 {
-	if (digitalRead(RP_in) == LOW) {
-		keyerControl |= DIT_L;
-	}
-	if (digitalRead(LP_in) == LOW) {
-		keyerControl |= DAH_L;
-	}
+	keyerControl |= _down | _pressed;
+	_pressed = 0;
+}
+
+// hold_us is only for the edge trace: how long this level should last
+void Keyer::key(bool on, unsigned long hold_us)
+{
+	cw_line(_channel, on, hold_us);
+}
+
+// Key down for one element of len usec
+void Keyer::start_element(unsigned long len)
+{
+	key(true, len);
+	_remain += len;
+	keyerControl &= ~(DIT_L + DAH_L);  // clear both paddle latch bits
+	_pressed = 0;
+	keyerState = KEYED;
 }
 
-bool Keyer::do_paddles()
+//======================================================================
+//    Keyer state machine, from the CW tick interrupt
+//======================================================================
+
+// Supports Iambic A and B and a straight key.  _remain counts down the
+// current key down or key up interval in CW_TICK_US steps; an element
+// that follows straight on starts in the same tick, with the overshoot
+// carried into it, so tick quantization does not accumulate.  Nothing
+// depends on micros() or millis(), so nothing breaks when they wrap.
+void Keyer::tick()
 {
+	paddle_edge();
+
 	if (key_mode == STRAIGHT) { // Straight Key
-		if ((digitalRead(LP_in) == LOW) || (digitalRead(RP_in) == LOW)) {
-// Key from either paddle
-			digitalWrite(ptt_pin_, HIGH);
-			digitalWrite(cw_pin_, HIGH);
-//      tone(ST_Pin, 600);
-			return true;
-		} else {
-			digitalWrite(ptt_pin_, LOW);
-			digitalWrite(cw_pin_, LOW);
-//      noTone(ST_Pin);
+		_pressed = 0;           // no latches, the key follows the paddles
+		if (_down && keyerState == IDLE) {
+			key(true, 0);       // Key from either paddle
+			keyerState = KEYED;
+		} else if (!_down && keyerState != IDLE) {
+			key(false, 0);
+			keyerState = IDLE;
 		}
-		return false;
+		return;
 	}
 
-// keyerControl contains processing flags and keyer mode bits
-// Supports Iambic A and B
-// State machine based, uses calls to millis() for timing.
-  switch (keyerState) {
-    case IDLE:      // Wait for direct or latched paddle press
-      if ((digitalRead(LP_in) == LOW) || (digitalRead(RP_in) == LOW) || (keyerControl & 0x03)) {
-        update_PaddleLatch();
-        keyerState = CHK_DIT;
-        return true;
-      }
-      return false;
-//      break;
-    case CHK_DIT:      // See if the dit paddle was pressed
-      if (keyerControl & DIT_L) {
-        keyerControl |= DIT_PROC;
-        ktimer = _dotlen;
-        keyerState = KEYED_PREP;
-        return true;
-      }  // fall through
-        keyerState = CHK_DAH;
-    case CHK_DAH:      // See if dah paddle was pressed
-      if (keyerControl & DAH_L) {
-        ktimer = _dashlen;
-        keyerState = KEYED_PREP;
-        return true;
-      } else {
-        keyerState = IDLE;
-        return false;
-      }
-//      break;
-    case KEYED_PREP:                     // Assert key down, start timing
-                                         // state shared for dit or dah
-      digitalWrite(ptt_pin_, HIGH);      // Enable PTT
-//      tone(ST_Pin, ST_Freq);           // Turn the Sidetone on
-      digitalWrite(cw_pin_, HIGH);       // Key the CW line
-      ktimer += millis();                // set ktimer to interval end time
-      keyerControl &= ~(DIT_L + DAH_L);  // clear both paddle latch bits
-      keyerState = KEYED;                // next state
-      return true;
-//      break;
-    case KEYED:                          // Wait for timer to expire
-      if (millis() > ktimer) {           // are we at end of key down ?
-        digitalWrite(ptt_pin_, LOW);     // Disable PTT 
-//        noTone(ST_Pin);                // Turn the Sidetone off
-        digitalWrite(cw_pin_, LOW);      // Unkey the CW line
-        ktimer = millis() + _space_len;  // inter-element time
-        keyerState = INTER_ELEMENT;      // next state
-        return true;
-      }
-      else if (key_mode == IAMBICB)     // Iambic B Mode ?
-        update_PaddleLatch();           // yes, early paddle latch in Iambic B mode
-      return true;
-//      break;
-
-    case INTER_ELEMENT:                 // Insert time between dits/dahs
-      update_PaddleLatch();             // latch paddle state
-      if (millis() > ktimer) {          // are we at end of inter-space ?
-        if (keyerControl & DIT_PROC) {  // was it a dit or dah ?
-          keyerControl &= ~(DIT_L + DIT_PROC);   // clear two bits
-          keyerState = CHK_DAH;                  // dit done, check for dah
-          return true;
-        } else {
-          keyerControl &= ~(DAH_L);     // clear dah latch
-          keyerState = IDLE;            // go idle
-          return false;
-        }
-      }
-      return true;
-//      break;
-  }
+	for (;;) {
+		switch (keyerState) {
+			case IDLE:          // Wait for direct or latched paddle press
+				if (!(_down || _pressed || (keyerControl & 0x03)))
+					return;
+				update_PaddleLatch();
+				keyerState = CHK_DIT;
+				break;
+			case CHK_DIT:       // See if the dit paddle was pressed
+				if (keyerControl & DIT_L) {
+					keyerControl |= DIT_PROC;
+					start_element(_timing.dot);
+					return;
+				}
+				keyerState = CHK_DAH;
+				break;
+			case CHK_DAH:       // See if dah paddle was pressed
+				if (keyerControl & DAH_L) {
+					start_element(_timing.dash);
+					return;
+				}
+				keyerState = IDLE;
+				if (_down || _pressed || (keyerControl & 0x03))
+					break;          // straight on with the next element
+				trace_line(_channel, TRACE_CW, LOW, 0);    // key up until further notice
+				_remain = 0;
+				return;
+			case KEYED:         // Wait for end of key down
+				if (key_mode == IAMBICB)    // early paddle latch in Iambic B mode
+					update_PaddleLatch();
+				_remain -= CW_TICK_US;
+				if (_remain > 0)
+					return;
+				key(false, _timing.space);
+				_remain += _timing.space;   // inter-element time
+				keyerState = INTER_ELEMENT;
+				if (key_mode != IAMBICB)    // Iambic A: forget taps made
+					_pressed = 0;           // during the element
+				return;
+			case INTER_ELEMENT: // Insert time between dits/dahs
+				update_PaddleLatch();
+				_remain -= CW_TICK_US;
+				if (_remain > 0)
+					return;
+				if (keyerControl & DIT_PROC) {  // was it a dit or dah ?
+					keyerControl &= ~(DIT_L + DIT_PROC);  // dit done, check for dah
+				} else {
+					keyerControl &= ~(DAH_L);   // clear dah latch
+				}
+				keyerState = CHK_DAH;
+				break;
+		}
+	}
 }
-
-
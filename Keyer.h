@@ -33,42 +33,63 @@
 #include "Arduino.h"
 
 #include "config.h"
+#include "CWTiming.h"
 
 #define IAMBICA 0
 #define IAMBICB 1
 #define STRAIGHT 2
 
+// The keyer drives the CW line of one channel, see KeyLines.h, and
+// reads LP_in / RP_in through FastPin, so the pin assignments in
+// config.h are fixed at compile time.  PTT is left to the sketch's
+// PttSequencer for that channel.
+//
+// Paddle contacts are watched by the pin change interrupt, which calls
+// paddle_edge().  A press is latched there, so one shorter than a pass
+// of the main loop still counts; each paddle then ignores further
+// changes for PADDLE_DEBOUNCE_US.
+//
+// The keying itself runs from the CW tick interrupt: tick(), every
+// CW_TICK_US, samples the paddles and advances the element state
+// machine, so element lengths do not depend on what the main loop is
+// doing.
+
 class Keyer
 {
 private:
-	int  cw_pin_;
-	int  ptt_pin_;
-  
-	long ktimer;
+	long _remain;          // microseconds left in current element or space
 
   int _speed;
-  int _dashlen;  // Length of dash
-  int _dotlen;   // Length of dot
-  int _space_len; // Length of space
-  float _weight;
+  int _weight;           // dash/dot ratio in hundredths
+  CWTiming _timing;      // element lengths in usec
 
 	char keyerControl;
-	char keyerState;
+	volatile char keyerState;
 	int  key_mode;
+	byte _channel;         // whose CW line is keyed
+
+	volatile byte _down;      // debounced paddles, DIT_L / DAH_L bits
+	volatile byte _pressed;   // paddles pressed since last latched
+	unsigned long _edge[2];   // micros() of last change, dit and dah
 
   void calc_ratio();
 	void update_PaddleLatch();
+	void key(bool on, unsigned long hold_us);
+	void start_element(unsigned long len);
 
 public:
-	Keyer(int wpm, float _weight);
-	void cw_pin(int pin);
-	void ptt_pin(int pin);
+	Keyer(int wpm, int weight);
 	void wpm(int spd);
+	void weight(int wt);
 	void set_mode(int md);
   int  get_mode() { return key_mode; }
-  void set__weight();
+	void set_channel(byte ch);
+	byte get_channel() { return _channel; }
  
-	bool do_paddles();
+	bool busy();              // paddles keying
+	bool active();            // keying, or a paddle touched
+	void tick();              // call every CW_TICK_US
+	void paddle_edge();       // from the pin change interrupt
 
 };
 
@@ -24,128 +24,146 @@
 //**********************************************************************
 
 #include "Arduino.h"
+#include <avr/pgmspace.h>
 #include "Morse.h"
+#include "constants.h"
+#include "KeyLines.h"
 
 // Morse conversion table from ASCII (offset by 33);
 // code is reverse binary for send method
-// terminated with a leftmost 1, i.e. A .- = 0b00000110
-// Entry with value 0b000000001 has no morse equivalent
-
-const  byte _ascii_to_morse[] = {
-	0b01110101,  // !
-	0b01010010,  // "
-	0b00000001,  // #
-	0b11001000,  // $
-	0b01101000,  // % <SK>
-	0b00011010,  // & <AS>
-	0b01011110,  // '
-	0b00101101,  // (  
-	0b01101101,  // )
-	0b00000001,  // *
-	0b00101101,  // + <KN>
-	0b01110011,  // ,
-	0b00110001,  // - <BT>
-	0b00101010,  // .
-	0b00101001,  // /
-	0b00111111,  // 0
-	0b00111110,  // 1
-	0b00111100,  // 2
-	0b00111000,  // 3
-	0b00110000,  // 4
-	0b00100000,  // 5
-	0b00100001,  // 6
-	0b00100011,  // 7
-	0b00100111,  // 8
-	0b00101111,  // 9
-	0b01000111,  // :
-	0b01010101,  // ;
-	0b00100010,  // <  <AS>
-	0b00110001,  // =  <BT>
-	0b00101010,  // >  <AR>
-	0b01001100,  // ?
-	0b01010110,  // @
-	0b00000110,  // A
-	0b00010001,  // B
-	0b00010101,  // C
-	0b00001001,  // D
-	0b00000010,  // E
-	0b00010100,  // F
-	0b00001011,  // G
-	0b00010000,  // H
-	0b00000100,  // I
-	0b00011110,  // J
-	0b00001101,  // K
-	0b00010010,  // L
-	0b00000111,  // M
-	0b00000101,  // N
-	0b00001111,  // O
-	0b00010110,  // P
-	0b00011011,  // Q
-	0b00001010,  // R
-	0b00001000,  // S
-	0b00000011,  // T
-	0b00001100,  // U
-	0b00011000,  // V
-	0b00001110,  // W
-	0b00011001,  // X
-	0b00011101,  // Y
-	0b00010011,  // Z
-	0b00000001,  // [
-	0b01000000,  // backslash 6 dits
-	0b00000001,  // ]
-	0b00000001,  // ^
-	0b01101100,  // _
-	0b01011110,  // `
-	0b00000110,  // a
-	0b00010001,  // b
-	0b00010101,  // c
-	0b00001001,  // d
-	0b00000010,  // e
-	0b00010100,  // f
-	0b00001011,  // g
-	0b00010000,  // h
-	0b00000100,  // i
-	0b00011110,  // j
-	0b00001101,  // k
-	0b00010010,  // l
-	0b00000111,  // m
-	0b00000101,  // n
-	0b00001111,  // o
-	0b00010110,  // p
-	0b00011011,  // q
-	0b00001010,  // r
-	0b00001000,  // s
-	0b00000011,  // t
-	0b00001100,  // u
-	0b00011000,  // v
-	0b00001110,  // w
-	0b00011001,  // x
-	0b00011101,  // y
-	0b00010011,  // z
-	0b01110000,  // left brace  <HM> ....--
-	0b00000001,  // vertical bar
-	0b00101000,  // right brace <VE> ...-.
-	0b00000001,  // tilde
+// terminated with a leftmost 1, i.e. A .- = 0b0000000000000110
+// Entry with value 0b0000000000000001 has no morse equivalent
+// 16 bits leave room for up to CW_CODE_MAX elements, see join().
+// Kept in flash; bytes outside '!'..'~' have no entry at all.
+
+const  uint16_t _ascii_to_morse[] PROGMEM = {
+	0b0000000001110101,  // !
+	0b0000000001010010,  // "
+	0b0000000000000001,  // #
+	0b0000000011001000,  // $
+	0b0000000001101000,  // % <SK>
+	0b0000000000011010,  // & <AS>
+	0b0000000001011110,  // '
+	0b0000000000101101,  // (  
+	0b0000000001101101,  // )
+	0b0000000000000001,  // *
+	0b0000000000101101,  // + <KN>
+	0b0000000001110011,  // ,
+	0b0000000000110001,  // - <BT>
+	0b0000000000101010,  // .
+	0b0000000000101001,  // /
+	0b0000000000111111,  // 0
+	0b0000000000111110,  // 1
+	0b0000000000111100,  // 2
+	0b0000000000111000,  // 3
+	0b0000000000110000,  // 4
+	0b0000000000100000,  // 5
+	0b0000000000100001,  // 6
+	0b0000000000100011,  // 7
+	0b0000000000100111,  // 8
+	0b0000000000101111,  // 9
+	0b0000000001000111,  // :
+	0b0000000001010101,  // ;
+	0b0000000000100010,  // <  <AS>
+	0b0000000000110001,  // =  <BT>
+	0b0000000000101010,  // >  <AR>
+	0b0000000001001100,  // ?
+	0b0000000001010110,  // @
+	0b0000000000000110,  // A
+	0b0000000000010001,  // B
+	0b0000000000010101,  // C
+	0b0000000000001001,  // D
+	0b0000000000000010,  // E
+	0b0000000000010100,  // F
+	0b0000000000001011,  // G
+	0b0000000000010000,  // H
+	0b0000000000000100,  // I
+	0b0000000000011110,  // J
+	0b0000000000001101,  // K
+	0b0000000000010010,  // L
+	0b0000000000000111,  // M
+	0b0000000000000101,  // N
+	0b0000000000001111,  // O
+	0b0000000000010110,  // P
+	0b0000000000011011,  // Q
+	0b0000000000001010,  // R
+	0b0000000000001000,  // S
+	0b0000000000000011,  // T
+	0b0000000000001100,  // U
+	0b0000000000011000,  // V
+	0b0000000000001110,  // W
+	0b0000000000011001,  // X
+	0b0000000000011101,  // Y
+	0b0000000000010011,  // Z
+	0b0000000000000001,  // [
+	0b0000000001000000,  // backslash 6 dits
+	0b0000000000000001,  // ]
+	0b0000000000000001,  // ^
+	0b0000000001101100,  // _
+	0b0000000001011110,  // `
+	0b0000000000000110,  // a
+	0b0000000000010001,  // b
+	0b0000000000010101,  // c
+	0b0000000000001001,  // d
+	0b0000000000000010,  // e
+	0b0000000000010100,  // f
+	0b0000000000001011,  // g
+	0b0000000000010000,  // h
+	0b0000000000000100,  // i
+	0b0000000000011110,  // j
+	0b0000000000001101,  // k
+	0b0000000000010010,  // l
+	0b0000000000000111,  // m
+	0b0000000000000101,  // n
+	0b0000000000001111,  // o
+	0b0000000000010110,  // p
+	0b0000000000011011,  // q
+	0b0000000000001010,  // r
+	0b0000000000001000,  // s
+	0b0000000000000011,  // t
+	0b0000000000001100,  // u
+	0b0000000000011000,  // v
+	0b0000000000001110,  // w
+	0b0000000000011001,  // x
+	0b0000000000011101,  // y
+	0b0000000000010011,  // z
+	0b0000000001110000,  // left brace  <HM> ....--
+	0b0000000000000001,  // vertical bar
+	0b0000000000101000,  // right brace <VE> ...-.
+	0b0000000000000001,  // tilde
 };
 
-Morse::Morse(int wpm, float weight)
+Morse::Morse(int wpm, int weight, byte channel)
 {
 	// Save values for later use
+	_channel = channel;
 	_speed = wpm;
+	_fspeed = 0;
 	_wt = weight;
+	_next = 0;
+	_nextcode = 1;
+	_join = 0;
+	_state = IDLE;
+	_hold = false;
+	_redo = false;
+	_lastc = 0;
+	_lastcode = 1;
+	_remain = 0;
 	calc_ratio();
 }
 
 // Calculate the length of dot, dash and silence
 void Morse::calc_ratio()
 {
-  float w = (1 + _wt) / (_wt -1);
-	_spacelen = (1200 / _speed);
-	_dotlen = _spacelen * (w - 1);
-	_dashlen =  (1 + w) * _spacelen;
+	CWTiming t(_speed, _wt, _fspeed);
+
+	uint8_t sreg = SREG;
+	cli();
+	_timing = t;
+	SREG = sreg;
 }
 
-void Morse::weight(float wt)
+void Morse::weight(int wt)
 {
 	_wt = wt;
 	calc_ratio();
@@ -157,54 +175,197 @@ void Morse::wpm(int spd)
 	calc_ratio();
 }
 
-void Morse::dash(byte pin)
+void Morse::farnsworth(int spd)
+{
+	_fspeed = spd;
+	calc_ratio();
+}
+
+// hold_us is only for the edge trace: how long this level should last
+void Morse::key(bool on, unsigned long hold_us)
+{
+	cw_line(_channel, on, hold_us);
+}
+
+// Code for one character: a bounds checked read of the table, the
+// same time for every byte
+uint16_t Morse::code(char c)
+{
+	byte b = (byte) c;
+	if (b < '!' || b > '~')
+		return 1;
+	return pgm_read_word(&_ascii_to_morse[b - '!']);
+}
+
+// The elements of b run on after those of a, with no letter space.
+// Any that would take it past CW_CODE_MAX are left off.
+uint16_t Morse::join(uint16_t a, uint16_t b)
+{
+	byte n = 0;
+	while ((a >> n) > 1)
+		n++;                    // elements in a; its leftmost 1 is bit n
+	while (b > 1 && n < CW_CODE_MAX) {
+		a = (a & ~((uint16_t)1 << n)) | ((b & 1) << n) | ((uint16_t)2 << n);
+		b /= 2;
+		n++;
+	}
+	return a;
+}
+
+// Stage a character for the tick interrupt to pick up.  Characters
+// from a CW_JOIN to the next are joined here instead, and the group
+// is staged as one character when it closes.
+bool Morse::send(char c)
 {
-	digitalWrite(pin, HIGH);
-	delay(_dashlen);
-	digitalWrite(pin, LOW);
-	delay(_spacelen);
+	if (_next)
+		return false;
+	if (c == CW_JOIN) {
+		uint16_t g = _join;
+		if (g > 1) {
+			_nextcode = g;
+			_next = c;          // staged before the group closes, for busy()
+		}
+		_join = g ? 0 : 1;      // close the group, or open an empty one
+		return true;
+	} else if (_join) {
+		uint16_t g = join(_join, code(c));
+		uint8_t sreg = SREG;
+		cli();                  // busy() reads it from the tick interrupt
+		_join = g;
+		SREG = sreg;
+		return true;
+	} else
+		_nextcode = code(c);
+	_next = c;
+	return true;
 }
 
-void Morse::dit(byte pin)
+// Stage an open group as it stands, or drop it if it has no elements.
+// With a character already staged it is left open, to try again.
+void Morse::close()
 {
-	digitalWrite(pin, HIGH);
-	delay(_dotlen);
-	digitalWrite(pin, LOW);
-	delay(_spacelen);
+	if (_join)
+		send(CW_JOIN);
 }
 
-char lastc = 0;
+// Drop the staged character and anything in progress, key up now
+void Morse::abort()
+{
+	uint8_t sreg = SREG;
+	cli();
+	_next = 0;
+	_join = 0;
+	if (_state == MARK)
+		key(false, 0);
+	_state = IDLE;
+	_hold = false;
+	_redo = false;
+	_remain = 0;
+	SREG = sreg;
+}
+
+// Paused after an element and the space that follows it; if elements
+// of the character remain, send it again from the start on resuming
+void Morse::stop()
+{
+	_redo = _state == ELEMENT_GAP && _code != 1;
+	_state = IDLE;
+	_remain = 0;
+}
 
-void Morse::send(char c, byte pin)
+void Morse::start_char(char c, uint16_t code)
 {
-	byte _i;
-	byte _p;
+	_t = _timing;
 
 	// Send space
 	if (c == ' ') {
-		if (lastc == ' ')
-			delay(7 * _spacelen);
+		unsigned long gap;
+		if (_lastc == ' ')
+			gap = _t.space + _t.letter + _t.word;
 		else
-			delay(4 * _spacelen);
-		return ;
+			gap = _t.word;
+		trace_line(_channel, TRACE_CW, LOW, gap);
+		_remain += gap;
+		_state = WORD_GAP;
+		_lastc = c;
+		return;
 	}
 
-	// Do a table lookup to get morse data
-	else {
-		_i = ((byte) c) - 33;
-		_p = _ascii_to_morse[_i];
-	}
+	_code = code;
+	_lastc = c;
+	_lastcode = code;
+	start_element();
+}
 
-	// Main algorithm for each morse sign
-	while (_p != 1) {
-		if (_p & 1)
-			dash(pin);
-		else
-			dit(pin);
-		_p = _p / 2;
+void Morse::start_element()
+{
+	// Letterspace once the leftmost 1 is all that remains
+	if (_code == 1) {
+		trace_line(_channel, TRACE_CW, LOW, _t.letter);
+		_remain += _t.letter;
+		_state = CHAR_GAP;
+		return;
 	}
-	// Letterspace
-	delay(2 * _spacelen);
+	unsigned long len = (_code & 1) ? _t.dash : _t.dot;
+	key(true, len);
+	_remain += len;
+	_code = _code / 2;
+	_state = MARK;
 }
 
+void Morse::end_interval()
+{
+	switch (_state) {
+		case MARK :
+			key(false, _t.space);
+			_remain += _t.space;
+			_state = ELEMENT_GAP;
+			break;
+		case ELEMENT_GAP :
+			start_element();
+			break;
+		default : // CHAR_GAP, WORD_GAP
+			_state = IDLE;
+			break;
+	}
+}
 
+// Called from the CW tick interrupt.  _remain carries any overshoot
+// into the next interval so tick quantization does not accumulate.
+// When paused, an element being sent and the space after it are
+// finished; a letter or word gap, which already holds a space, is cut
+// short.
+void Morse::tick()
+{
+	if (_state != IDLE) {
+		_remain -= CW_TICK_US;
+		if (_hold && (_state == CHAR_GAP || _state == WORD_GAP)) {
+			stop();
+			return;
+		}
+		if (_remain > 0)
+			return;
+		if (_hold && _state == ELEMENT_GAP) {
+			stop();
+			return;
+		}
+		end_interval();
+		if (_state == IDLE && _next == 0)
+			trace_line(_channel, TRACE_CW, LOW, 0);	// key up until further notice
+	}
+	if (_state == IDLE) {
+		if (_hold || (_next == 0 && !_redo)) {
+			_remain = 0;
+			return;
+		}
+		if (_redo) {
+			_redo = false;
+			start_char(_lastc, _lastcode);
+		} else {
+			char c = _next;
+			uint16_t k = _nextcode;
+			_next = 0;
+			start_char(c, k);
+		}
+	}
+}
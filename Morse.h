@@ -29,23 +29,73 @@
 
 #include "Arduino.h"
 
+#include "config.h"
+#include "CWTiming.h"
+
+// Morse characters are generated from the CW tick interrupt.  send()
+// only stages the next character and returns at once; tick() walks a
+// per-character state machine of key down / key up intervals on the CW
+// line of its channel, see KeyLines.h.
+//
+// Characters are looked up in a table of 16 bit codes in flash when
+// they are staged; text between two CW_JOIN characters is joined into
+// one code there and staged when the group closes, see constants.h.
+// A group the host leaves open is closed by close() at the end of the
+// transmission, and dropped by abort().
+//
+// pause() stops sending at the end of the current element and its
+// space, for paddle break-in.  A character cut short is sent again
+// from its start after resume().
+
 class Morse
 {
 	public:
-		Morse(int wpm, float weight);
-		void send(char c, byte pin);
-		void weight(float wt);
+		Morse(int wpm, int weight, byte channel = 0);
+		bool send(char c);            // false if a character is already staged
+		static uint16_t code(char c); // 1 if c has no Morse
+		bool ready() { return _next == 0; }
+		bool busy() { return _state != IDLE || _next != 0 || _redo || _join > 1; }
+		void close();                 // stage or drop an open CW_JOIN group
+		void abort();
+		void pause() { _hold = true; }
+		void resume() { _hold = false; }
+		bool paused() { return _hold; }
+		bool held() { return _hold && _state == IDLE; }  // key line free
+		void tick();                  // call every CW_TICK_US
+		void weight(int wt);
 		void wpm(int spd);
+		void farnsworth(int spd);
 	private:
+    enum { IDLE, MARK, ELEMENT_GAP, CHAR_GAP, WORD_GAP };
+
+    byte _channel; // whose CW line is keyed
     byte _speed;   // Speed in WPM
+    byte _fspeed;  // Farnsworth overall speed in WPM, 0 for none
+    int  _wt;      // weight 250 to 350; 300 nominal
+
+    CWTiming _timing;  // element lengths for the current settings
+
+// working copy used by tick(); latched at the start of each character
+// so that a speed change never alters a character already being sent
+    CWTiming _t;
 
-    int _dashlen;  // Length of dash
-    int _dotlen;   // Length of dot
-    int _spacelen; // Length of space
-    float _wt;     // weight 2.5 to 3.5; 3.0 nominal
+    volatile char _next;     // staged character, 0 if none
+    volatile uint16_t _nextcode; // and its code
+    volatile uint16_t _join; // run-together group being put together, 0 if none
+    volatile byte _state;
+    volatile bool _hold;     // paused, or pausing at the end of the element
+    volatile bool _redo;     // _lastc was cut short and is to be sent again
+    uint16_t _code;          // elements remaining in current character
+    char _lastc;
+    uint16_t _lastcode;
+    long _remain;            // microseconds left in current interval
 
-		void dash(byte pin);
-		void dit(byte pin);
+		void key(bool on, unsigned long hold_us);
+		void start_char(char c, uint16_t code);
+		void stop();
+		void start_element();
+		void end_interval();
     void calc_ratio();
+    static uint16_t join(uint16_t a, uint16_t b);
 };
 #endif
@@ -0,0 +1,180 @@
+//**********************************************************************
+//
+// OutputQueue, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#include "Arduino.h"
+#include "OutputQueue.h"
+
+static_assert(OUT_QUEUE_SIZE <= 256 && (OUT_QUEUE_SIZE & (OUT_QUEUE_SIZE - 1)) == 0,
+	"OUT_QUEUE_SIZE must be a power of two no larger than 256");
+
+// A queued byte of 0 starts a flash string marker; the flash address
+// follows.  A literal 0 is queued as a marker with a null address.
+#define OUT_MARK 0
+#define OUT_MARK_LEN (1 + sizeof(PGM_P))
+
+OutputQueue::OutputQueue(HardwareSerial &port) : _port(port)
+{
+	_head = 0;
+	_tail = 0;
+	_end = 0;
+	_open = false;
+	_failed = false;
+	_spare = 0;
+	_flash = 0;
+	_dropped = 0;
+}
+
+// Starts a reply that is to be sent whole or not at all, and leave
+// spare bytes of room
+void OutputQueue::begin(byte spare)
+{
+	_open = true;
+	_failed = false;
+	_spare = spare;
+}
+
+// Ends it; false if it did not fit and has been dropped, which is
+// counted unless the caller is going to try again
+bool OutputQueue::end(bool count)
+{
+	_open = false;
+	if (_failed || room() < _spare) {
+		_failed = false;
+		_head = _end;
+		if (count)
+			_dropped++;
+		return false;
+	}
+	_end = _head;
+	return true;
+}
+
+// A write did not fit.  Inside a reply the whole of it is dropped by
+// end(), and the rest is not written.
+void OutputQueue::lost()
+{
+	if (_open)
+		_failed = true;
+	else
+		_dropped++;
+}
+
+// Room for n more bytes, passing what the serial port will take
+// straight on first.  Never waits.
+bool OutputQueue::make_room(byte n)
+{
+	if (room() >= n)
+		return true;
+	service();
+	return room() >= n;
+}
+
+size_t OutputQueue::write(uint8_t b)
+{
+	if (_failed)
+		return 0;
+	if (b == OUT_MARK) {
+		if (!make_room(OUT_MARK_LEN)) {
+			lost();
+			return 0;
+		}
+		put(OUT_MARK);
+		for (byte i = 0; i < sizeof(PGM_P); i++)
+			put(0);
+	} else {
+		if (!make_room(1)) {
+			lost();
+			return 0;
+		}
+		put(b);
+	}
+	if (!_open)
+		_end = _head;
+	return 1;
+}
+
+size_t OutputQueue::print(const __FlashStringHelper *str)
+{
+	PGM_P p = reinterpret_cast<PGM_P>(str);
+	if (_failed)
+		return 0;
+	if (!make_room(OUT_MARK_LEN)) {
+		lost();
+		return 0;
+	}
+	put(OUT_MARK);
+	const byte *a = (const byte *)&p;
+	for (byte i = 0; i < sizeof(PGM_P); i++)
+		put(a[i]);
+	if (!_open)
+		_end = _head;
+	return 1;
+}
+
+// Next byte to send, -1 when there is nothing queued
+int OutputQueue::next()
+{
+	for (;;) {
+		if (_flash) {
+			byte c = pgm_read_byte(_flash++);
+			if (c)
+				return c;
+			_flash = 0;
+		}
+		if (_tail == _end)
+			return -1;
+		byte b = get();
+		if (b != OUT_MARK)
+			return b;
+		PGM_P p;
+		byte *a = (byte *)&p;
+		for (byte i = 0; i < sizeof(PGM_P); i++)
+			a[i] = get();
+		if (!p)
+			return 0;
+		_flash = p;
+	}
+}
+
+// Hand the serial port as much as its transmit buffer will take
+void OutputQueue::service()
+{
+	int n = _port.availableForWrite();
+	while (n-- > 0) {
+		int c = next();
+		if (c < 0)
+			break;
+		_port.write((uint8_t)c);
+	}
+}
+
+// Wait until everything queued has gone out of the serial port
+void OutputQueue::flush()
+{
+	int c;
+	while ((c = next()) >= 0)
+		_port.write((uint8_t)c);
+	_port.flush();
+}
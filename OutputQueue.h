@@ -0,0 +1,91 @@
+//**********************************************************************
+//
+// OutputQueue, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef OutputQueue_h
+#define OutputQueue_h
+
+#include "Arduino.h"
+#include "constants.h"
+
+// Everything the sketch sends to the host goes through this queue.
+//
+// Writes only ever copy into RAM and return; service(), called from the
+// main loop, moves bytes on to the serial port as far as its transmit
+// buffer has room, so nothing waits on the host reading the port.  A
+// byte or string that does not fit is dropped and counted.
+//
+// A reply made of several writes goes between begin() and end(), so
+// the host gets all of it or none of it: nothing written after begin()
+// is sent before end(), and if any part did not fit end() takes the
+// lot back out again and counts one drop.  begin(n) also drops it if
+// it would leave less than n bytes free.  A reply longer than the
+// queue has to be split up; a part that did not fit can be tried
+// again once empty() says everything before it has gone on to the
+// serial port.
+//
+// print(F("...")) does not copy the text: the queue holds a marker and
+// the flash address, and service() reads the string from flash as it
+// goes out.  A long banner costs a few bytes of queue space.
+
+class OutputQueue : public Print
+{
+public:
+	OutputQueue(HardwareSerial &port);
+
+	virtual size_t write(uint8_t b);
+	using Print::write;
+	size_t print(const __FlashStringHelper *str);
+	using Print::print;
+
+	void begin(byte spare = 0);
+	bool end(bool count = true);
+
+	void service();
+	virtual void flush();
+
+	bool empty() { return _tail == _head; }
+	unsigned int dropped() { return _dropped; }
+
+private:
+	HardwareSerial &_port;
+	byte _buf[OUT_QUEUE_SIZE];
+	byte _head;             // next slot to fill
+	byte _tail;             // next slot to send
+	byte _end;              // end of what may be sent, _head outside begin() ... end()
+	bool _open;             // between begin() and end()
+	bool _failed;           // and something did not fit
+	byte _spare;            // room it has to leave
+	PGM_P _flash;           // flash string being sent, 0 if none
+	unsigned int _dropped;
+
+	byte room() { return (byte)(_tail - _head - 1) % OUT_QUEUE_SIZE; }
+	void put(byte b) { _buf[_head] = b; _head = (_head + 1) % OUT_QUEUE_SIZE; }
+	void lost();
+	byte get() { byte b = _buf[_tail]; _tail = (_tail + 1) % OUT_QUEUE_SIZE; return b; }
+	bool make_room(byte n);
+	int next();
+};
+
+#endif
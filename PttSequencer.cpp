@@ -0,0 +1,118 @@
+//**********************************************************************
+//
+// PttSequencer, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#include "Arduino.h"
+#include "config.h"
+#include "KeyLines.h"
+#include "PttSequencer.h"
+
+PttSequencer::PttSequencer(byte channel)
+{
+	_channel = channel;
+	_users = 0;
+	_state = OFF;
+	_last = PTT_HOST;
+	_remain = 0;
+	_lead = PTT_LEAD_MS * 1000UL;
+	_tail = PTT_TAIL_MS * 1000UL;
+	_hang = PTT_HANG_MS * 1000UL;
+}
+
+void PttSequencer::set(unsigned long &t, unsigned int ms)
+{
+	uint8_t sreg = SREG;
+	cli();
+	t = ms * 1000UL;
+	SREG = sreg;
+}
+
+void PttSequencer::lead(unsigned int ms)
+{
+	set(_lead, ms);
+}
+
+void PttSequencer::tail(unsigned int ms)
+{
+	set(_tail, ms);
+}
+
+void PttSequencer::hang(unsigned int ms)
+{
+	set(_hang, ms);
+}
+
+// Safe from the main loop and from interrupts
+void PttSequencer::hold(byte user, bool on)
+{
+	uint8_t sreg = SREG;
+	cli();
+	if (on)
+		_users |= user;
+	else if (_users & user) {
+		_users &= ~user;
+		if (!_users)
+			_last = user;
+	}
+	SREG = sreg;
+}
+
+// The lead and tail are whole ticks, never shorter than asked for
+bool PttSequencer::tick()
+{
+	switch (_state) {
+		case OFF :
+			if (!_users)
+				return false;
+			ptt_line(_channel, HIGH);
+			_remain = _lead;
+			_state = LEAD;
+			break;
+		case LEAD :
+			_remain -= CW_TICK_US;
+			break;
+		case ON :
+			if (_users)
+				return false;
+			_remain = (_last == PTT_HOST) ? _tail : _hang;
+			_state = TAIL;
+			break;
+		case TAIL :
+			if (_users) {
+				_state = ON;
+				return false;
+			}
+			_remain -= CW_TICK_US;
+			break;
+	}
+	if (_remain > 0)
+		return false;
+	if (_state == LEAD) {
+		_state = ON;
+		return false;
+	}
+	ptt_line(_channel, LOW);
+	_state = OFF;
+	return true;
+}
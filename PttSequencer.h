@@ -0,0 +1,78 @@
+//**********************************************************************
+//
+// PttSequencer, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef PttSequencer_h
+#define PttSequencer_h
+
+#include "Arduino.h"
+#include "constants.h"
+
+// Users of the transmitter, any number of which may hold it at once
+#define PTT_HOST  0x01    // [ ... ], FSK text and tune
+#define PTT_MORSE 0x02    // buffered CW
+#define PTT_KEYER 0x04    // paddles
+
+// Drives the PTT line of one channel, see KeyLines.h, for everything
+// that transmits on it.
+//
+// PTT goes on as soon as anyone holds it, but ready() only becomes true
+// lead msec later, and nothing may key before then, so an amplifier or
+// relay has switched before the first edge.  When the last holder lets
+// go PTT stays on for the tail (after the host) or the hang (after CW,
+// for semi break-in); a hold in that time carries on with no new lead.
+//
+// All timing is counted in tick(), from the CW tick interrupt, so
+// nothing in the main loop waits.
+
+class PttSequencer
+{
+public:
+	PttSequencer(byte channel = 0);
+
+	void lead(unsigned int ms);
+	void tail(unsigned int ms);
+	void hang(unsigned int ms);
+
+	void hold(byte user, bool on);
+	bool on() { return _state != OFF; }
+	bool ready() { return _state == ON || _state == TAIL; }
+	bool tick();              // call every CW_TICK_US; true as PTT drops
+
+private:
+	enum { OFF, LEAD, ON, TAIL };
+
+	byte _channel;            // whose PTT line
+	volatile byte _users;     // PTT_ bits of those holding it
+	volatile byte _state;
+	byte _last;               // the last to let go
+	long _remain;             // usec left of the lead or tail
+	unsigned long _lead;      // usec
+	unsigned long _tail;
+	unsigned long _hang;
+
+	void set(unsigned long &t, unsigned int ms);
+};
+
+#endif
@@ -0,0 +1,58 @@
+//**********************************************************************
+//
+// RamCheck, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#include "Arduino.h"
+#include "RamCheck.h"
+
+extern uint8_t __heap_start;    // end of .bss, from the linker
+extern uint8_t *__brkval;       // top of the heap, 0 until malloc()
+
+// Runs from .init3, after the stack pointer is set and before the
+// variables are initialized, so nothing is on the stack yet.  Naked and
+// never called: it falls through to the next init section.
+void ram_paint() __attribute__((naked, used, section(".init3")));
+void ram_paint()
+{
+	for (uint8_t *p = &__heap_start; p < (uint8_t *)SP; p++)
+		*p = RAM_PAINT;
+}
+
+static uint8_t *heap_end()
+{
+	return __brkval ? __brkval : &__heap_start;
+}
+
+unsigned int ram_free()
+{
+	return (uint8_t *)SP - heap_end();
+}
+
+unsigned int stack_unused()
+{
+	uint8_t *p = heap_end();
+	while (p < (uint8_t *)SP && *p == RAM_PAINT)
+		p++;
+	return p - heap_end();
+}
@@ -0,0 +1,41 @@
+//**********************************************************************
+//
+// RamCheck, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef RamCheck_h
+#define RamCheck_h
+
+#include "Arduino.h"
+
+// The 2 KB of SRAM above the variables is shared by the heap, which
+// nanoIO does not use, and the stack growing down from the top.  It is
+// painted with RAM_PAINT before setup() runs; bytes the stack has
+// never reached still hold it.
+
+#define RAM_PAINT 0xC5
+
+unsigned int ram_free();       // between the heap and the stack now
+unsigned int stack_unused();   // never touched by the stack since reset
+
+#endif
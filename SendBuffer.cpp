@@ -0,0 +1,114 @@
+//**********************************************************************
+//
+// SendBuffer, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#include "Arduino.h"
+#include "SendBuffer.h"
+
+SendBuffer::SendBuffer()
+{
+	_head = 0;
+	_tail = 0;
+	_peak = 0;
+}
+
+// 16 bit index access is two instructions on the AVR; keep the other
+// side from seeing half of an update.  SREG is restored rather than
+// interrupts enabled so this is also safe to call from an ISR.
+unsigned int SendBuffer::load(volatile unsigned int &idx)
+{
+	uint8_t sreg = SREG;
+	cli();
+	unsigned int val = idx;
+	SREG = sreg;
+	return val;
+}
+
+void SendBuffer::store(volatile unsigned int &idx, unsigned int val)
+{
+	uint8_t sreg = SREG;
+	cli();
+	idx = val;
+	SREG = sreg;
+}
+
+unsigned int SendBuffer::count()
+{
+	unsigned int head = load(_head);
+	unsigned int tail = load(_tail);
+	if (head >= tail)
+		return head - tail;
+	return head + SEND_BUFFER_SIZE + 1 - tail;
+}
+
+unsigned int SendBuffer::room()
+{
+	return SEND_BUFFER_SIZE - count();
+}
+
+// Append one byte; returns false (and drops the byte) when full
+bool SendBuffer::put(byte b)
+{
+	unsigned int head = _head;
+	unsigned int nxt = next(head);
+	unsigned int tail = load(_tail);
+	if (nxt == tail)
+		return false;
+	_buf[head] = b;
+	store(_head, nxt);
+	unsigned int used = (nxt >= tail) ? nxt - tail : nxt + SEND_BUFFER_SIZE + 1 - tail;
+	if (used > _peak)
+		_peak = used;
+	return true;
+}
+
+// Oldest unsent byte, left in the buffer; 0 when empty
+byte SendBuffer::peek()
+{
+	unsigned int tail = _tail;
+	if (tail == load(_head))
+		return 0;
+	return _buf[tail];
+}
+
+// Remove and return the oldest unsent byte; 0 when empty
+byte SendBuffer::get()
+{
+	unsigned int tail = _tail;
+	if (tail == load(_head))
+		return 0;
+	byte b = _buf[tail];
+	store(_tail, next(tail));
+	return b;
+}
+
+// Discard everything unsent.  This moves the consumer index, so it is
+// done in one step that the producer cannot interleave with.
+void SendBuffer::clear()
+{
+	uint8_t sreg = SREG;
+	cli();
+	_tail = _head;
+	SREG = sreg;
+}
@@ -0,0 +1,77 @@
+//**********************************************************************
+//
+// SendBuffer, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef SendBuffer_h
+#define SendBuffer_h
+
+#include "Arduino.h"
+#include "constants.h"
+
+// Single producer / single consumer ring buffer for the transmit text.
+//
+// The producer (serial intake) only ever moves _head and the consumer
+// (CW or FSK transmit, which may run from a timer ISR) only ever moves
+// _tail.  Both indices are 16 bit, so the opposite index is read with
+// interrupts masked for the two byte load; everything else is lock free
+// and every operation costs the same regardless of how full it is.
+//
+// One slot is always left open to tell "full" from "empty", so the
+// array is one larger than the configured SEND_BUFFER_SIZE.
+
+class SendBuffer
+{
+public:
+	SendBuffer();
+
+	// producer side
+	bool put(byte b);
+	unsigned int room();
+
+	// consumer side
+	byte peek();
+	byte get();
+	void clear();
+
+	// either side
+	unsigned int count();
+	bool empty() { return count() == 0; }
+
+	// most ever held, for the runtime report
+	unsigned int peak() { return _peak; }
+	void clear_peak() { _peak = 0; }
+
+private:
+	byte _buf[SEND_BUFFER_SIZE + 1];
+	volatile unsigned int _head;   // next slot to fill
+	volatile unsigned int _tail;   // next slot to send
+	unsigned int _peak;            // producer side only
+
+	unsigned int load(volatile unsigned int &idx);
+	void store(volatile unsigned int &idx, unsigned int val);
+	unsigned int next(unsigned int idx)
+		{ return (idx == SEND_BUFFER_SIZE) ? 0 : idx + 1; }
+};
+
+#endif
@@ -0,0 +1,118 @@
+//**********************************************************************
+//
+// Sidetone, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#include "Arduino.h"
+#include "Sidetone.h"
+#include "constants.h"
+#include "FastPin.h"
+
+#ifdef SIDETONE
+
+// 510 clocks per phase correct PWM period
+#define SIDETONE_RATE (F_CPU / 510)
+
+static_assert((F_CPU / 1000000UL) * CW_TICK_US == 510UL * SIDETONE_TICK_DIV,
+	"CW_TICK_US must be SIDETONE_TICK_DIV sample periods");
+
+// one cycle
+static const int8_t sine[64] PROGMEM = {
+	   0,   12,   25,   37,   49,   60,   71,   81,
+	  90,   98,  106,  112,  117,  122,  125,  126,
+	 127,  126,  125,  122,  117,  112,  106,   98,
+	  90,   81,   71,   60,   49,   37,   25,   12,
+	   0,  -12,  -25,  -37,  -49,  -60,  -71,  -81,
+	 -90,  -98, -106, -112, -117, -122, -125, -126,
+	-127, -126, -125, -122, -117, -112, -106,  -98,
+	 -90,  -81,  -71,  -60,  -49,  -37,  -25,  -12,
+};
+
+// raised cosine, 255 * (1 - cos(pi * i / SIDETONE_RAMP_TICKS)) / 2
+static const byte ramp[SIDETONE_RAMP_TICKS + 1] PROGMEM = {
+	0, 2, 10, 21, 37, 57, 79, 103, 127, 152, 176, 198, 218, 234, 245, 253, 255
+};
+
+static volatile uint16_t st_step;   // phase step per sample, 0 for no tone
+static volatile bool st_keyed;
+static uint16_t st_phase;
+static byte st_level;               // index into ramp[]
+static byte st_amp;                 // ramp[st_level]
+static byte st_div;                 // samples since the last CW tick
+static volatile byte st_channel;    // the channel heard
+
+void sidetone_init()
+{
+	uint8_t sreg = SREG;
+	cli();
+	TCCR2A = _BV(COM2B1) | _BV(WGM20);  // phase correct PWM on OC2B, TOP 0xFF
+	TCCR2B = _BV(CS20);                 // no prescale
+	TCNT2  = 0;
+	OCR2B  = 128;
+	TIMSK2 = _BV(TOIE2);
+	SREG = sreg;
+	FastPin<3>::output();               // OC2B
+}
+
+void sidetone_freq(unsigned int hz)
+{
+	uint16_t step = (uint32_t)hz * 65536UL / SIDETONE_RATE;
+
+	uint8_t sreg = SREG;
+	cli();
+	st_step = step;
+	SREG = sreg;
+}
+
+void sidetone_key(byte channel, bool on)
+{
+	if (channel == st_channel)
+		st_keyed = on;
+}
+
+// A key down on the channel left behind would otherwise sound on
+void sidetone_follow(byte channel)
+{
+	st_channel = channel;
+	st_keyed = false;
+}
+
+ISR(TIMER2_OVF_vect)
+{
+	int8_t s = pgm_read_byte(&sine[st_phase >> 10]);
+	OCR2B = 128 + ((s * st_amp) >> 8);
+	st_phase += st_step;
+
+	if (++st_div < SIDETONE_TICK_DIV)
+		return;
+	st_div = 0;
+	if (st_keyed && st_step) {
+		if (st_level < SIDETONE_RAMP_TICKS)
+			st_level++;
+	} else if (st_level)
+		st_level--;
+	st_amp = pgm_read_byte(&ramp[st_level]);
+	cw_tick();
+}
+
+#endif
@@ -0,0 +1,68 @@
+//**********************************************************************
+//
+// Sidetone, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef Sidetone_h
+#define Sidetone_h
+
+#include "Arduino.h"
+
+#include "config.h"
+
+// CW sidetone, enabled with SIDETONE in config.h.
+//
+// Timer2 runs phase correct PWM on OC2B (D3) from the full clock, a
+// 31.4 kHz carrier, and its overflow interrupt is the sample clock: a
+// phase accumulator steps through a 64 point sine table in flash.  Key
+// down and key up ramp the level along a raised cosine over
+// SIDETONE_RAMP_TICKS CW ticks, about 4 msec, so the tone does not
+// click.  Keying comes from the same calls that write CW_PIN; with
+// more than one channel only the one being followed is heard.
+//
+// The overflow interrupt also calls cw_tick() every SIDETONE_TICK_DIV
+// samples, in place of the Timer2 compare interrupt used without a
+// sidetone; that makes CW_TICK_US 255.
+//
+// With SIDETONE undefined SIDETONE_KEY() and SIDETONE_FOLLOW() expand
+// to nothing.
+
+#ifdef SIDETONE
+
+#define SIDETONE_TICK_DIV   8   // samples per CW tick
+#define SIDETONE_RAMP_TICKS 16
+
+void sidetone_init();           // takes over Timer2
+void sidetone_freq(unsigned int hz);    // 0 for no tone
+void sidetone_key(byte channel, bool on);
+void sidetone_follow(byte channel);
+void cw_tick();                 // supplied by the sketch
+
+#  define SIDETONE_KEY(ch, on) sidetone_key(ch, on)
+#  define SIDETONE_FOLLOW(ch) sidetone_follow(ch)
+#else
+#  define SIDETONE_KEY(ch, on)
+#  define SIDETONE_FOLLOW(ch)
+#endif
+
+#endif
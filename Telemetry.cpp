@@ -0,0 +1,77 @@
+//**********************************************************************
+//
+// Telemetry, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#include "Arduino.h"
+#include "Telemetry.h"
+
+#define CLOCKS_PER_USEC (F_CPU / 1000000L)
+
+TickCounter::TickCounter()
+{
+	_count = 0;
+	_period = CLOCKS_PER_USEC;
+	_due = 0;
+	_dueClocks = 0;
+	_missed = 0;
+}
+
+void TickCounter::period(unsigned long clocks)
+{
+	uint8_t sreg = SREG;
+	cli();
+	_count = 0;
+	SREG = sreg;
+	_period = clocks;
+	_due = micros();
+	_dueClocks = 0;
+}
+
+void TickCounter::check(unsigned long now)
+{
+	uint8_t sreg = SREG;
+	cli();
+	unsigned int n = _count;
+	_count = 0;
+	SREG = sreg;
+
+	unsigned long c = _dueClocks + n * _period;
+	_due += c / CLOCKS_PER_USEC;
+	_dueClocks = c % CLOCKS_PER_USEC;
+
+	unsigned long period_us = _period / CLOCKS_PER_USEC;
+	long lag = now - _due;
+	if (lag < 0) {                    // a period rounded up runs ahead
+		_due = now;
+		_dueClocks = 0;
+		return;
+	}
+	if (lag < (long)(2 * period_us))
+		return;
+	unsigned long lost = lag / period_us - 1;
+	_missed += lost;
+	c = _dueClocks + lost * _period;
+	_due += c / CLOCKS_PER_USEC;
+	_dueClocks = c % CLOCKS_PER_USEC;
+}
@@ -0,0 +1,59 @@
+//**********************************************************************
+//
+// Telemetry, a part of nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//Revisions:
+//
+//1.0.0:  Initial release
+//
+//**********************************************************************
+
+#ifndef Telemetry_h
+#define Telemetry_h
+
+#include "Arduino.h"
+
+// Counts a periodic timer interrupt and, from the main loop, how many
+// of its periods went by without one: an interrupt held off for longer
+// than its period loses a tick, or in FSK a half-bit.
+//
+// The interrupt only bumps a counter.  check() compares the count with
+// micros(); ticks up to one period late are still on time, as one may
+// just be waiting to run.  The period is kept in CPU clocks so one of
+// 6666.5 usec (75 baud) does not drift.
+
+class TickCounter
+{
+public:
+	TickCounter();
+
+	void period(unsigned long clocks);  // set, and start counting again
+	void count() { _count++; }          // from the interrupt
+	void check(unsigned long now);      // from the main loop, micros()
+	unsigned long missed() { return _missed; }
+	void clear() { _missed = 0; }
+
+private:
+	volatile unsigned int _count;  // interrupts since the last check
+	unsigned long _period;         // clocks
+	unsigned long _due;            // micros() the counted ones came to
+	unsigned int _dueClocks;       // and clocks over
+	unsigned long _missed;
+};
+
+#endif
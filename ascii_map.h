@@ -43,137 +43,204 @@
 /// '\' are used to control the PTT behavior.  Tilda (~) is used to enter 
 /// the configuration menu.  You can use your imagination to add other 
 /// control functions here.
+///
+/// Each entry packs the 5 bit code with the shift it needs: letters
+/// need LTRS, figures and punctuation need FIGS, and NULL, LF, space
+/// and CR are the same in both.  The table is in flash and covers all
+/// 256 byte values, so one pgm_read_byte both converts and classifies
+/// any byte the host sends; bytes above 126 go out as '?'.
 
-int asciiToBaudot[127] = {
+#include <avr/pgmspace.h>
+
+#define BAUDOT_CODE 0x1F   // 5 bit Baudot code
+#define BAUDOT_LTRS 0x20   // needs LTRS shift
+#define BAUDOT_FIGS 0x40   // needs FIGS shift
+
+#define NEU(code) (code)
+#define LTR(code) ((code) | BAUDOT_LTRS)
+#define FIG(code) ((code) | BAUDOT_FIGS)
+
+#define FIG4(code)   FIG(code), FIG(code), FIG(code), FIG(code)
+#define FIG16(code)  FIG4(code), FIG4(code), FIG4(code), FIG4(code)
+#define FIG128(code) FIG16(code), FIG16(code), FIG16(code), FIG16(code), \
+                     FIG16(code), FIG16(code), FIG16(code), FIG16(code)
+
+const byte asciiToBaudot[256] PROGMEM = {
 
 //         ASCII             ASCII INDEX (decimal)
-  0,//  Null character             0
-  0,//  Start of Header            1
-  0,//  Start of Text              2
-  0,//  End of Text                3
-  0,//  End of Transmission        4
-  0,//  Enquiry                    5
-  0,//  Acknowledgment             6
-  5,//  Bell                       7
-  0,//  Backspace                  8
-  0,//  Horizontal Tab             9
-  2,//  Line feed                 10
-  0,//  Vertical Tab              11
-  0,//  Form feed                 12
-  8,//  Carriage return           13
-  0,//  Shift Out                 14
-  0,//  Shift In                  15
-  0,//  Data Link Escape          16
-  0,//  Device Control 1          17
-  0,//  Device Control 2          18
-  0,//  Device Control 3          19
-  0,//  Device Control 4          20
-  0,//  Negative Acknowledgement  21
-  0,//  Synchronous idle          22
-  0,//  End of Transmission Block 23
-  0,//  Cancel                    24
-  0,//  End of Medium             25
-  0,//  Substitute                26
-  0,//  Escape                    27
-  0,//  File Separator            28
-  0,//  Group Separator           29
-  0,//  Record Separator          30
-  0,//  Unit Separator            31
-  4,//  space                     32
-  13,// !                         33
-  17,// "                         34
-  20,// #                         35
-  9,//  $                         36
-  25,// %                         37
-  26,// &                         38
-  11,// '                         39
-  15,// (                         40
-  18,// )                         41
-  25,// *                         42
-  17,// +                         43  //ITA2
-  12,// ,                         44
-  3,//  -                         45
-  28,// .                         46
-  29,// /                         47
-  22,// 0                         48
-  23,// 1                         49
-  19,// 2                         50
-  1,//  3                         51
-  10,// 4                         52
-  16,// 5                         53
-  21,// 6                         54
-  7,//  7                         55
-  6,//  8                         56
-  24,// 9                         57
-  14,// :                         58
-  30,// ;                         59
-  25,// <                         60
-  30,// =                         61 //ITA2
-  25,// >                         62
-  25,// ?                         63
-  25,// @                         64
-  3,//  A                         65
-  25,// B                         66
-  14,// C                         67
-  9,//  D                         68
-  1,//  E                         69
-  13,// F                         70
-  26,// G                         71
-  20,// H                         72
-  6,//  I                         73
-  11,// J                         74
-  15,// K                         75
-  18,// L                         76
-  28,// M                         77
-  12,// N                         78
-  24,// O                         79
-  22,// P                         80
-  23,// Q                         81
-  10,// R                         82
-  5,//  S                         83
-  16,// T                         84
-  7,//  U                         85
-  30,// V                         86
-  19,// W                         87
-  29,// X                         88
-  21,// Y                         89
-  17,// Z                         90
-  15,// [ Used to start TX        91
-  20,// \ Used to escape TX       92
-  18,// ] Buffered end TX         93
-  25,// ^                         94
-  4,//  _                         95
-  25,// `                         96
-  3,//  a                         97
-  25,// b                         98
-  14,// c                         99
-  9,//  d                        100
-  1,//  e                        101
-  13,// f                        102
-  26,// g                        103
-  20,// h                        104
-  6,//  i                        105
-  11,// j                        106
-  15,// k                        107
-  18,// l                        108
-  28,// m                        109
-  12,// n                        110
-  24,// o                        111
-  22,// p                        112
-  23,// q                        113
-  10,// r                        114
-  5,//  s                        115
-  16,// t                        116
-  7,//  u                        117
-  30,// v                        118
-  19,// w                        119
-  29,// x                        120
-  21,// y                        121
-  17,// z                        122
-  15,// {                        123
-  20,// |                        124
-  18,// }                        125
-  25 // ~ Command escape char    126
+  NEU(0), // Null character              0
+  NEU(0), // Start of Header             1
+  NEU(0), // Start of Text               2
+  NEU(0), // End of Text                 3
+  NEU(0), // End of Transmission         4
+  NEU(0), // Enquiry                     5
+  NEU(0), // Acknowledgment              6
+  FIG(5), // Bell                        7
+  NEU(0), // Backspace                   8
+  NEU(0), // Horizontal Tab              9
+  NEU(2), // Line feed                  10
+  NEU(0), // Vertical Tab               11
+  NEU(0), // Form feed                  12
+  NEU(8), // Carriage return            13
+  NEU(0), // Shift Out                  14
+  NEU(0), // Shift In                   15
+  NEU(0), // Data Link Escape           16
+  NEU(0), // Device Control 1           17
+  NEU(0), // Device Control 2           18
+  NEU(0), // Device Control 3           19
+  NEU(0), // Device Control 4           20
+  NEU(0), // Negative Acknowledgement   21
+  NEU(0), // Synchronous idle           22
+  NEU(0), // End of Transmission Block  23
+  NEU(0), // Cancel                     24
+  NEU(0), // End of Medium              25
+  NEU(0), // Substitute                 26
+  NEU(0), // Escape                     27
+  NEU(0), // File Separator             28
+  NEU(0), // Group Separator            29
+  NEU(0), // Record Separator           30
+  NEU(0), // Unit Separator             31
+  NEU(4), // space                      32
+  FIG(13),// !                          33
+  FIG(17),// "                          34
+  FIG(20),// #                          35
+  FIG(9), // $                          36
+  FIG(25),// %                          37
+  FIG(26),// &                          38
+  FIG(11),// '                          39
+  FIG(15),// (                          40
+  FIG(18),// )                          41
+  FIG(25),// *                          42
+  FIG(17),// +                          43 //ITA2
+  FIG(12),// ,                          44
+  FIG(3), // -                          45
+  FIG(28),// .                          46
+  FIG(29),// /                          47
+  FIG(22),// 0                          48
+  FIG(23),// 1                          49
+  FIG(19),// 2                          50
+  FIG(1), // 3                          51
+  FIG(10),// 4                          52
+  FIG(16),// 5                          53
+  FIG(21),// 6                          54
+  FIG(7), // 7                          55
+  FIG(6), // 8                          56
+  FIG(24),// 9                          57
+  FIG(14),// :                          58
+  FIG(30),// ;                          59
+  FIG(25),// <                          60
+  FIG(30),// =                          61 //ITA2
+  FIG(25),// >                          62
+  FIG(25),// ?                          63
+  FIG(25),// @                          64
+  LTR(3), // A                          65
+  LTR(25),// B                          66
+  LTR(14),// C                          67
+  LTR(9), // D                          68
+  LTR(1), // E                          69
+  LTR(13),// F                          70
+  LTR(26),// G                          71
+  LTR(20),// H                          72
+  LTR(6), // I                          73
+  LTR(11),// J                          74
+  LTR(15),// K                          75
+  LTR(18),// L                          76
+  LTR(28),// M                          77
+  LTR(12),// N                          78
+  LTR(24),// O                          79
+  LTR(22),// P                          80
+  LTR(23),// Q                          81
+  LTR(10),// R                          82
+  LTR(5), // S                          83
+  LTR(16),// T                          84
+  LTR(7), // U                          85
+  LTR(30),// V                          86
+  LTR(19),// W                          87
+  LTR(29),// X                          88
+  LTR(21),// Y                          89
+  LTR(17),// Z                          90
+  FIG(15),// [ Used to start TX         91
+  FIG(20),// \ Used to escape TX        92
+  FIG(18),// ] Buffered end TX          93
+  FIG(25),// ^                          94
+  NEU(4), // _                          95
+  FIG(25),// `                          96
+  LTR(3), // a                          97
+  LTR(25),// b                          98
+  LTR(14),// c                          99
+  LTR(9), // d                         100
+  LTR(1), // e                         101
+  LTR(13),// f                         102
+  LTR(26),// g                         103
+  LTR(20),// h                         104
+  LTR(6), // i                         105
+  LTR(11),// j                         106
+  LTR(15),// k                         107
+  LTR(18),// l                         108
+  LTR(28),// m                         109
+  LTR(12),// n                         110
+  LTR(24),// o                         111
+  LTR(22),// p                         112
+  LTR(23),// q                         113
+  LTR(10),// r                         114
+  LTR(5), // s                         115
+  LTR(16),// t                         116
+  LTR(7), // u                         117
+  LTR(30),// v                         118
+  LTR(19),// w                         119
+  LTR(29),// x                         120
+  LTR(21),// y                         121
+  LTR(17),// z                         122
+  FIG(15),// {                         123
+  FIG(20),// |                         124
+  FIG(18),// }                         125
+  FIG(25),// ~ Command escape char     126
+  NEU(0), // Delete                    127
+
+// 8 bit values                  128..255
+  FIG128(25)
+};
+
+#undef FIG128
+#undef FIG16
+#undef FIG4
+
+/// Packed table entry for any byte: code | shift class
+inline byte baudotEntry(byte asciiByte)
+{
+  return pgm_read_byte(&asciiToBaudot[asciiByte]);
+}
+
+/// Reverse mapping for the echo.  Codes are queued for transmit with
+/// their class bits, so the echo shows what actually goes out: the
+/// substitutes above come back as '?' and so on.  Lower case is kept
+/// with BAUDOT_LOWER; the shift codes themselves are not echoed.
+
+#define BAUDOT_LOWER 0x80  // queued letter was lower case
+#define BAUDOT_KEEP 0x80   // queued LTRS or FIGS: send even if already in it
+
+const char baudotToAscii[2][32] PROGMEM = {
+  { // LTRS
+    0,    'E',  '\n', 'A',  ' ',  'S',  'I',  'U',
+    '\r', 'D',  'R',  'J',  'N',  'F',  'C',  'K',
+    'T',  'Z',  'L',  'W',  'H',  'Y',  'P',  'Q',
+    'O',  'B',  'G',  0,    'M',  'X',  'V',  0,
+  },
+  { // FIGS
+    0,    '3',  '\n', '-',  ' ',  '\a', '8',  '7',
+    '\r', '$',  '4',  '\'', ',',  '!',  ':',  '(',
+    '5',  '"',  ')',  '2',  '#',  '6',  '0',  '1',
+    '9',  '?',  '&',  0,    '.',  '/',  ';',  0,
+  }
 };
 
+/// ASCII for a queued code (code | class | BAUDOT_LOWER); 0 for none
+inline byte baudotEcho(byte entry)
+{
+  byte c = pgm_read_byte(&baudotToAscii[(entry & BAUDOT_FIGS) ? 1 : 0][entry & BAUDOT_CODE]);
+  if ((entry & BAUDOT_LOWER) && c >= 'A' && c <= 'Z')
+    c += 'a' - 'A';
+  return c;
+}
+
 #endif // _ASCIIMAP_H_
@@ -81,4 +81,41 @@
 #  endif
 #endif
 
+//----------------------------------------------------------------------
+// Second radio (SO2R)
+// uncomment to drive two radios from one board.  Each channel has its
+// own FSK, CW and PTT lines, mode, speeds, PTT times and send buffer;
+// ~@n picks the channel that host text, settings and the paddles go
+// to.  The send buffer is shared out between the two.
+//#define SO2R 1
+#define FSK2_PIN 6
+#define CW2_PIN  7
+#define PTT2_PIN 8
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+// Paddle contacts: after a paddle is seen to change, further changes
+// on it are ignored for this long (usec) while the contact settles.
+// Keep it well below a dit at the highest keyer speed (12 msec at 100
+// WPM).
+#define PADDLE_DEBOUNCE_US 3000
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+// Sidetone
+// uncomment for a CW monitor tone on D3 (OC2B, the Timer2 PWM output);
+// feed headphones or a small amplifier through an RC low pass, e.g.
+// 1k and 100nF.  Timer2 then runs the PWM and the CW tick is 255 usec
+// instead of 250.  ~Hnnnh changes the pitch, 0 for none.
+//#define SIDETONE 1
+#define SIDETONE_HZ 600
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+// Instrumentation
+// uncomment to record keying edge times and a deviation histogram,
+// reported with the ~J command.  Uses about 420 bytes of RAM.
+//#define EDGE_TRACE 1
+//----------------------------------------------------------------------
+
 #endif // __CONFIG_H_
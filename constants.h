@@ -33,20 +33,116 @@
 #ifndef _CONSTANTS_H_
 #define _CONSTANTS_H_
 
+#include "config.h"
+
+// Radios driven, see SO2R in config.h
+#ifdef SO2R
+#define CHANNELS 2
+#else
+#define CHANNELS 1
+#endif
+
 //BUFFER SETTINGS
-// Allow up to 300 chars in the buffer before overrunning (wrapping around).
-// This can be increased on most boards with more RAM.
-#define SEND_BUFFER_SIZE 300
+// Allow up to 500 chars in the buffer before overrunning (wrapping around).
+// The character tables live in flash, which leaves room for this on a
+// Nano; it can be increased further on boards with more RAM.  With two
+// channels each has a buffer of half the size.
+#define SEND_BUFFER_SIZE (500 / CHANNELS)
+
+// Output to the host is queued here and passed to the serial port as it
+// has room.  Flash strings take a few bytes each however long they are.
+// A power of two, at most 256.
+#define OUT_QUEUE_SIZE 256
+
+// Reports longer than the output queue, printed by the loop a part at
+// a time; pending ones go out in this order.
+#define REPORT_CONFIG    0x01   // ~? and at start up
+#define REPORT_PROMPT    0x02   // ~~ and at start up
+#define REPORT_READY     0x04   // "cmd:" at start up
+#define REPORT_TELEMETRY 0x08   // ~R
+#define REPORT_EDGES     0x10   // ~J, EDGE_TRACE builds
+// Room a report leaves in the output queue for echo and short replies
+#define REPORT_SPARE 64
 
 #define MIN_CW_WPM 5
 #define MAX_CW_WPM 100
+
+// CW element timing is advanced from a Timer2 compare interrupt at this
+// period (microseconds).  Element lengths are carried over from tick to
+// tick so there is no cumulative error; each edge lands within one tick
+// of its ideal time.  With the sidetone the tick is 8 periods of its
+// PWM instead.
+#ifdef SIDETONE
+#define CW_TICK_US 255
+#else
+#define CW_TICK_US 250
+#endif
+
+// Touching a paddle while buffered CW is being sent pauses it at the
+// end of the element.  It carries on once the paddles have been idle
+// this long (milliseconds, ~G), or with 0 the rest of the buffer is
+// dropped instead.
+#define BREAKIN_HANG_MS 1000
+#define MAX_BREAKIN_HANG_MS 9999
+
+// PTT sequencing (milliseconds).  PTT goes on PTT_LEAD_MS before the
+// first keying edge (~O).  It stays on PTT_TAIL_MS after the host ends
+// a transmission (~X), and PTT_HANG_MS after the last CW element,
+// buffered or from the paddles (~Y), so semi break-in keeps the
+// transmitter on between words.
+#define PTT_LEAD_MS 150
+#define PTT_TAIL_MS 25
+#define PTT_HANG_MS 600
+#define MAX_PTT_MS 9999
+
+// With flow reports on (~Q) the buffer state is sent to the host at
+// most this often (milliseconds), and only when it has changed.
+#define FLOW_REPORT_MILLIS 100
+
+// Serial input is moved by the CW tick interrupt to a ring of this many
+// bytes (a power of two, at most 128) for the loop, at most
+// SERIAL_TICK_BYTES a tick: more than 250000 baud brings in, few
+// enough to keep the interrupt short.
+#define SERIAL_RING_SIZE 64
+#define SERIAL_TICK_BYTES 8
 ///---------------------------------------------------------------------
 
 //EEPROM addresses to persist configuration
+#define EE_CONFIG_ADDR 0       // wear levelled configuration records
+#define EE_CONFIG_SIZE 512
+#define EE_MEMORY_ADDR 512     // message memories, to the end of EEPROM
+
+// Where earlier versions kept the configuration, inside the records'
+// region now; read once when no valid record has been written yet.
 #define EE_SPEED_ADDR 0
 #define EE_POLARITY_ADDR 1
 #define EE_CW_STRUC_ADDR 2
 
+// A changed configuration is saved once it has stayed the same for
+// CONFIG_QUIET_MILLIS, so a run of ~I steps or a knob on the host
+// costs one record.  The loop looks for changes every
+// CONFIG_CHECK_MILLIS.
+#define CONFIG_QUIET_MILLIS 5000
+#define CONFIG_CHECK_MILLIS 250
+
+// Message memories.  Each holds up to MEMORY_SIZE - 1 characters of
+// text, ended by a 0 byte, and is sent when the host sends its single
+// trigger byte.  [ and ] in a memory key and unkey as they do from the
+// host, and MEMORY_NUMBER is replaced by the contest serial number,
+// which then goes up by one when the memory has been queued.
+#define MEMORY_COUNT 6
+#define MEMORY_SIZE 64
+#define MEMORY_FIRST 0x14      // DC4 sends memory 1 ... EM memory 6
+#define MEMORY_NUMBER '#'
+#define MAX_CONTEST_NR 9999
+
+// CW text between two CW_JOIN characters goes out as one character,
+// its letters run together with no letter space: *SK*, *HH* for the
+// eight dit error, *SOS*.  A group stops taking elements at
+// CW_CODE_MAX, the most a 16 bit code holds.
+#define CW_JOIN '*'
+#define CW_CODE_MAX 15
+
 //Special Baudot symbols for shift
 #define LTRS_SHIFT 0x1F  //baudot letter shift byte
 #define FIGS_SHIFT 0x1B  //baudot figs shift byte
@@ -59,6 +155,7 @@
 #define ASCII_CR 0x0D
 
 #define TX_END_FLAG 0xFF      // Used in Baudot stream to indicate EOT
+#define FSK_EMPTY 0xFE        // Nothing staged for the half-bit interrupt
 
 //References used in banging out the bits for 5-bit baudot. These
 //are relative to the first data bit in the frame.
@@ -80,12 +177,64 @@
 #define COMMAND_100BAUD '9'
 #define COMMAND_DUMP_CONFIG '?'
 
-// Stop bit settings
+// Binary settings frames, an alternative to the ~ commands that sets
+// several things in one exchange:
+//   host:  FRAME_START len { id value_lo value_hi } ... check
+//   reply: FRAME_START 3 status applied_lo applied_hi check
+// len counts the bytes between it and check; check makes the 8 bit sum
+// of len, those bytes and check zero.  Bit n of applied is set when
+// record n was accepted.  A frame that stops arriving is dropped after
+// FRAME_TIMEOUT_MILLIS.
+#define FRAME_START 0x02          // ASCII STX, never part of TX text
+#define FRAME_MAX_RECORDS 8
+#define FRAME_TIMEOUT_MILLIS 100
+
+// frame reply status
+#define FRAME_OK         0        // every record applied
+#define FRAME_REJECTED   1        // some records unknown or out of range
+#define FRAME_BAD_CHECK  2        // nothing applied
+#define FRAME_BAD_LENGTH 3        // nothing applied
+#define FRAME_TIMEOUT    4        // nothing applied
+
+// frame setting ids and values
+#define SET_MODE       0          // FSK_MODE, CW_MODE
+#define SET_WPM        1          // MIN_CW_WPM ... MAX_CW_WPM
+#define SET_KEY_WPM    2          // MIN_CW_WPM ... MAX_CW_WPM
+#define SET_WEIGHT     3          // dash/dot ratio, 250 ... 350
+#define SET_FARNSWORTH 4          // 0 (off) or MIN_CW_WPM ... MAX_CW_WPM
+#define SET_INCR       5          // 1 ... 9
+#define SET_KEYER      6          // IAMBICA, IAMBICB, STRAIGHT
+#define SET_BAUD       7          // baud * 100, MIN_BAUD100 ... MAX_BAUD100
+#define SET_MARK       8          // FSK mark level, LOW or HIGH
+#define SET_SAVE       9          // save to EEPROM, value ignored
+#define SET_CONTEST_NR 10         // next serial number, 1 ... MAX_CONTEST_NR
+#define SET_SIDETONE   11         // Hz, 0 = off; SIDETONE builds only
+#define SET_BREAKIN    12         // break-in hang msec, 0 = drop the buffer
+#define SET_PTT_LEAD   13         // msec, 0 ... MAX_PTT_MS
+#define SET_PTT_TAIL   14         // msec, 0 ... MAX_PTT_MS
+#define SET_PTT_HANG   15         // msec, 0 ... MAX_PTT_MS
+#define SET_STOP_BITS  16         // STOP_BITS_1, STOP_BITS_1R5, STOP_BITS_2
+#define SET_CHANNEL    17         // 1 ... CHANNELS, for what follows
+#define SET_USOS       18         // USOS_OFF, USOS_ON, USOS_MMTTY_HACK
+#define SET_COUNT     19
+
+// Host serial speeds selectable with ~Ln, n = 1 ... 6; the digit is
+// what is saved in the EEPROM.  250000 is exact on a 16 MHz clock.
+#define SERIAL_SPEED_DEFAULT '1'
+#define SERIAL_SPEED_MAX     '6'
+
+// FSK rates, in hundredths of a baud as they are set and saved.  Any
+// rate in range is generated exactly, see BaudClock.
+#define DEFAULT_BAUD100 4545
+#define MIN_BAUD100     1600
+#define MAX_BAUD100     30000
+
+// Stop bit settings, the half bits added to the first one
 #define STOP_BITS_1     1    // 1 stop bit
 #define STOP_BITS_1R5   2    // 1.5 stop bits
 #define STOP_BITS_2     3    // 2 stop bits
 
-// TX USOS settings
+// TX USOS settings, ~$n with n = the value
 #define USOS_OFF  1       //Assumes that RX will not reset to LTRS shift after space
 //All shift symbols are explicit and spaces do not change
 //shift state:
@@ -6,7 +6,7 @@
 
   It is designed to fit within the RAM and I/O constraints of an Arduino 
   Nano circuit board.  It generates either CW 5 to 100 WPM Morse code, 
-  or FSK Baudot hardline signals of 45.45, 50 or 75 Baud.
+  or FSK Baudot hardline signals of 16 to 300 Baud.
 
   Copyright (C) 2018 David Freese W1HKJ
   Derived from tinyFSK by Andrew T. Flowers K0SM
@@ -30,9 +30,15 @@
 
 ***********************************************************************/
 
-#include "TimerOne.h"
-#include "Morse.h"
+#include "Channel.h"
 #include "Keyer.h"
+#include "OutputQueue.h"
+#include "ConfigStore.h"
+#include "Telemetry.h"
+#include "RamCheck.h"
+#include "KeyLines.h"
+#include "EdgeTrace.h"
+#include "Sidetone.h"
 
 #include "EEPROM.h"
 #include "constants.h"
@@ -53,69 +59,96 @@
 ********************************************************/
 
 long serialSpeed = 9600; //This is the speed for the serial
-//(more likely USB) connection, 8-N-1
+//(more likely USB) connection, 8-N-1.  Selected with ~Ln and kept in EEPROM.
+byte serialSpeedChar = SERIAL_SPEED_DEFAULT;
 
-// Not user selectable, but USOS behavior can be changed here.
-// We set this to TX extra shifts to be compatible with silly
-// MMTTY default reciever
-int usos = USOS_MMTTY_HACK;
-
-int stopBits =  STOP_BITS_1R5;  // TX 1.5 stop bits
+// Host serial speeds for ~L1 ... ~L6
+const unsigned long serialSpeeds[] PROGMEM = {
+  9600, 19200, 38400, 57600, 115200, 250000
+};
 
 /***************************************
   Dynamic runtime variables these are minipulated with
   user commands or during normal TX operation.
 *****************************************/
-float baudrate = 45.45;  //default--can be changed by user command
-
-int pttLeadMillis = 150; //time before first start bit
-int pttTailMillis = 25;  //time after last stop bit
-
-
-// Polarity--changed with user commands and stored in EEPROM
-boolean mark = LOW;     //High indicates +V on the FSK/CW pin
-boolean space = HIGH;   //Low indicates 0V on the FSK/CW pin
-
-// Buffer management variables to handle TX text input
-byte sendBufferArray[SEND_BUFFER_SIZE];  // size of TX buffer
-byte sendBufferBytes = 0;    // number of bytes unsent in TX buffer
-byte lastAsciiByteSent = 0;  // needed to echo back sent characters to terminal
-boolean endWhenBufferEmpty = true;  //flag to kill TX when buffer empty (']')
-
-
-byte currentShiftState = SHIFT_UNKNOWN;  //Keeps track of Letter/Figs state to determine
-//if we need to send shift chars
 
-boolean ptt = false; // Keeps track of PTT state (true = Transmitter is on)
-
-volatile boolean isrFlag = false;   //set by timer interrupt.  Set high every 1/2 bit
-//to indicate when we should exectute the bit-banging
-//routine.  This is handled in the main loop function.
+// One channel per radio, see Channel.h: mode, CW and FSK settings, PTT
+// times, send buffer and transmit state.  Host text and the settings
+// commands go to the channel tx points at, chosen with ~@n; the
+// paddles follow it once they are idle.
+Channel channels[CHANNELS] = {
+  { 0 },
+#if CHANNELS > 1
+  { 1 },
+#endif
+};
+Channel *tx = &channels[0];
+
+OutputQueue hostOut(Serial); // everything sent back to the host
+byte reportsPending = 0;     // REPORT_ bits, see serviceReports()
+byte reportPart = 0;         // next part of the first of them
+boolean reportWait = false;  // it did not fit, try again once the queue is empty
+ConfigStore configStore;     // settings saved in EEPROM
+unsigned long configMillis = 0;
 
 boolean configurationMode = false;  //flag indicates if we are in the menu system or
 //in normal operation.
 
-int mode = DEFAULT_MODE;
+// Serial input is moved here by the tick interrupt, see serialTick(),
+// and the loop acts on it from here.  The counts run mod 256.
+volatile byte serialRing[SERIAL_RING_SIZE];
+volatile byte serialHead = 0;  // bytes put by the tick interrupt
+volatile byte serialTail = 0;  // bytes taken by the loop
+static_assert((SERIAL_RING_SIZE & (SERIAL_RING_SIZE - 1)) == 0 &&
+              SERIAL_RING_SIZE <= 128, "bad serial ring size");
+byte cmdReplies = 0;  // "cmd:" lines owed to the host by setPTT()
+
+// Flow control.  With reports on the host is told how much buffer is free,
+// how many bytes have been read from the serial port and how many buffered
+// characters have gone to the transmitter.  The counts are running totals
+// (mod 65536) so a lost report costs nothing; the host may have at most
+// "free" bytes in flight beyond the "read" count it has seen.
+boolean flowReports = false;
+unsigned int serialBytesRead = 0;
+unsigned int charsSent = 0;
+unsigned int reportedRead = 0;
+unsigned int reportedSent = 0;
+unsigned long lastReportMillis = 0;
+
+// Runtime report, ~R.  Cheap enough to be counting all the time; the
+// FSK half-bit interrupts are counted by each channel.
+TickCounter cwTicks;           // CW tick interrupts
+unsigned long loopMicros = 0;  // start of the last pass of loop()
+unsigned long loopMax = 0;     // longest pass, usec
+byte serialPeak = 0;           // most bytes seen waiting in the serial input
+unsigned int serialFull = 0;   // times it was found full, input may be lost
+unsigned int textDropped = 0;  // text with no room, dropped to let input through
+unsigned long cwSent = 0;      // characters sent since reset
+unsigned long fskSent = 0;
+unsigned long fskShifts = 0;   // LTRS / FIGS sent among them
+unsigned long fskShiftsSaved = 0; // queued shifts found not to be needed
 //----------------------------------------------------------------------
-// CW variables
 
-struct {
-  int   cw_wpm = 18;
-  float weight = 3.0;
-  int   incr   = 2;
-  int   key_wpm = 18;
-} CWstruc;
+byte numberCmd = 0;   // D, E, G, N, S ... while its digits are arriving
+int  numberArg = 0;
+byte charCmd = 0;     // I, L, M, P, Z, $ or @ waiting for its one character argument
+byte memoryRecord = 0;  // memory being recorded by ~Mn, 1 ... MEMORY_COUNT
+byte memoryPos = 0;
 
-int   spd_cmd = 18;
-float wt_cmd = 3.0;
+unsigned int contestNr = 1;  // next serial number for MEMORY_NUMBER
+unsigned int sidetoneHz = SIDETONE_HZ;  // SIDETONE builds, 0 = off
+unsigned int breakinHang = BREAKIN_HANG_MS;  // 0 drops the buffer
+unsigned long breakinMillis = 0;  // paddles last active during break-in
 
-boolean weight_string = false;
-boolean speed_string = false;
-boolean user_speed_string = false;
-boolean incr_char = false;
+// Binary settings frame being received, see handleFrameByte()
+boolean inFrame = false;
+unsigned int frameGot = 0; // bytes received after FRAME_START
+byte frameLen = 0;
+byte frameSum = 0;
+byte framePayload[FRAME_MAX_RECORDS * 3];
+unsigned long frameMillis = 0;
 
-Morse morse(CWstruc.cw_wpm, CWstruc.weight);
-Keyer keyer(CWstruc.key_wpm, CWstruc.weight);
+Keyer keyer(channels[0].cw.key_wpm, channels[0].cw.weight);
 
 //----------------------------------------------------------------------
 
@@ -133,51 +166,100 @@ Keyer keyer(CWstruc.key_wpm, CWstruc.weight);
 */
 void setup()
 {
+  eeLoad();
+  for (byte i = 1; i < CHANNELS; i++)
+    copySettings(channels[i], channels[0]);
+
   Serial.begin(serialSpeed);
   while (!Serial) {
     ; // wait for serial port to connect. Needed for Leonardo only
   }
   // configure pins for output
-  pinMode(FSK_PIN, OUTPUT);
-  pinMode(PTT_PIN, OUTPUT);
-  pinMode(CW_PIN, OUTPUT);
+  key_lines_output();
+
+  for (byte i = 0; i < CHANNELS; i++) {
+    Channel &c = channels[i];
+    c.morse.wpm(c.cw.cw_wpm);
+    c.morse.weight(c.cw.weight);
+    c.morse.farnsworth(c.cw.farns_wpm);
+    // start the half-bit timer.
+    initTimer(c);
+  }
+  keyer.wpm(tx->cw.key_wpm);
+  keyer.weight(tx->cw.weight);
+  // and the CW element timer
+  initTickTimer();
 
-  eeLoad();
+  reportsPending = REPORT_CONFIG | REPORT_PROMPT | REPORT_READY;
 
-  morse.wpm(CWstruc.cw_wpm);
-  morse.weight(CWstruc.weight);
-  keyer.wpm(CWstruc.key_wpm);
+  loopMicros = micros();
+}
 
-  displayConfiguration();
-  displayConfigurationPrompt();
 
-  // start the half-bit timer.
-  initTimer();
+/**
+  Moves serial input from the core's 64 byte receive buffer to
+  serialRing.  It is called from the tick interrupt so that a burst from
+  the host is taken before the receive buffer can overflow, whatever the
+  loop is doing.  Nothing else is done here, to keep the interrupt
+  short; the loop acts on the bytes in do_serial().  At most
+  SERIAL_TICK_BYTES are moved each tick.
+*/
+void serialTick()
+{
+  byte head = serialHead;
+  byte n = SERIAL_RING_SIZE - (byte)(head - serialTail);
 
-  Serial.write("cmd:\n"); // Tell N1MM we are in "RX" mode.  This will be sent
-  // at the end of transmission.
+  if (n > SERIAL_TICK_BYTES) n = SERIAL_TICK_BYTES;
+  for (; n && Serial.available() > 0; n--)
+    serialRing[head++ & (SERIAL_RING_SIZE - 1)] = Serial.read();
+  serialHead = head;
 }
 
-
 /**
-  Main loop.  This loop does two things:
-  (1) Process any input from the serial connection one byte at a time.
-
-  (2) If the half-bit timer interrupt fired we need to execute the bit-banging
-  routine to keep clocking out RTTY.
+  Acts on the serial input that serialTick() has moved to serialRing.
+  Text goes into the send buffer of the selected channel and [ ] \ act
+  at once.  Text that finds the send buffer full waits, and what
+  follows it with it, unless an abort is behind it or the ring has
+  filled up.  Then the text is dropped, and counted for the runtime
+  report, so that the abort or whatever else the host sends still gets
+  through.  While the paddles are keying a ~ command, settings frame or
+  memory trigger waits, along with anything after it.
 */
-
-void do_serial()
+void do_serial(boolean keying)
 {
-// Read up to SEND_BUFFER_SIZE characters from the USB serial port
-
-  while ((Serial.available() > 0) && (sendBufferBytes < SEND_BUFFER_SIZE)) {
+  byte held = serialHead - serialTail;
+  int waiting = Serial.available();
+  if (waiting + held > serialPeak) serialPeak = waiting + held;
+  if (waiting >= SERIAL_RX_BUFFER_SIZE - 1) serialFull++;
+
+  while (serialTail != serialHead) {
+    byte b = serialRing[serialTail & (SERIAL_RING_SIZE - 1)];
+    if (keying && (configurationMode || inFrame || b == COMMAND_ESCAPE ||
+                   b == FRAME_START || (b >= MEMORY_FIRST &&
+                                        b < MEMORY_FIRST + MEMORY_COUNT)))
+      break;
+    if (textRoom(*tx) == 0 && !configurationMode && !inFrame &&
+        !isControlByte(b)) {
+      if (!abortQueued() && (byte)(serialHead - serialTail) < SERIAL_RING_SIZE)
+        break;
+      serialTail++;
+      serialBytesRead++;
+      textDropped++;
+      continue;
+    }
+    if (memoryRecord && !eeprom_is_ready())
+      break;                  // see handleConfigurationCommand()
 
 // get incoming byte:
-    byte b = Serial.read();
+    serialTail++;
+    serialBytesRead++;
 
+// Binary settings frames are taken whole before anything else
+    if (inFrame) {
+      handleFrameByte(b);
+    }
 // Process configuration string if we are in configuration mode
-    if (configurationMode) {
+    else if (configurationMode) {
       echo(b);
       handleConfigurationCommand(b);
     }
@@ -187,59 +269,213 @@ void do_serial()
         configurationMode = true;
         echo(b);
         break;
+      case FRAME_START :
+        inFrame = true;
+        frameGot = 0;
+        frameMillis = millis();
+        break;
 // check for TX abort character.  This immediately kills the
 // transmitter and dumps anything remaining in the buffer.
-      case TX_ABORT : 
-        setPTT(false);
-        resetSendBuffer();
-        endWhenBufferEmpty = true;
+      case TX_ABORT :
+        tx->morse.abort();
+        setPTT(*tx, false);
+        resetSendBuffer(*tx);
+        tx->endWhenBufferEmpty = true;
         break;
-      case TX_ON : 
-        endWhenBufferEmpty = false;
-        setPTT(true);
+      case TX_ON :
+        tx->endWhenBufferEmpty = false;
+        setPTT(*tx, true);
         break;
-      case TX_END : 
-        endWhenBufferEmpty = true;
+      case TX_END :
+        tx->endWhenBufferEmpty = true;
         break;
       default :
+        if (b >= MEMORY_FIRST && b < MEMORY_FIRST + MEMORY_COUNT)
+          sendMemory(*tx, b - MEMORY_FIRST + 1);
+        else
 // add character (b) to send buffer
-        if (mode == FSK_MODE)
-          addToSendBuffer(b);
-        else {
-          if (b < ' ') {
-            addToSendBuffer(' ');
-          } else {
-            addToSendBuffer(b);
-          }
-        }
+          addToSendBuffer(*tx, b);
       }
-  }  // end while (Serial.available...)
+  }  // end while (serialTail...)
 
-// If the ISR fired we need may need to bit-bang something out the FSK port
-  if (mode == FSK_MODE) {
-    if (isrFlag) {
-      processHalfBit();
-      isrFlag = false;
-    } else
-      isrFlag = false;
+  if (inFrame && millis() - frameMillis >= FRAME_TIMEOUT_MILLIS) {
+    inFrame = false;
+    sendFrameReply(FRAME_TIMEOUT, 0);
+  }
+}
+
+/**
+  True if a \ abort is in serialRing among the text and transmit
+  control bytes at its start, before any ~ command or settings frame
+*/
+boolean abortQueued()
+{
+  for (byte i = serialTail; i != serialHead; i++) {
+    byte b = serialRing[i & (SERIAL_RING_SIZE - 1)];
+    if (b == TX_ABORT)
+      return true;
+    if (b == COMMAND_ESCAPE || b == FRAME_START)
+      return false;
+  }
+  return false;
+}
+
+/**
+  The half-bit interrupt does the bit-banging; keep it supplied with
+  the next character and drop PTT once it has sent the last one.  In
+  CW the Morse generator takes the next character as it is ready.
+*/
+void serviceChannel(Channel &c)
+{
+  if (c.mode == FSK_MODE) {
+    if (c.txEndReached) {
+      setPTT(c, false);
+    } else if (c.ptt && c.stagedChar == FSK_EMPTY) {
+      c.stagedChar = getNextSendChar(c);
+    }
   }
   else { // mode is CW_MODE
-    if (sendBufferBytes > 0) {
-      send_next_CW_char();
-    } else if (endWhenBufferEmpty) {
-      setPTT(false);
-      endWhenBufferEmpty = false;
+    if (!c.sendBuffer.empty()) {
+      send_next_CW_char(c);
+    } else if (c.endWhenBufferEmpty) {
+      c.morse.close();        // a * group the host left open
+      if (!c.morse.busy()) {
+        setPTT(c, false);
+        c.endWhenBufferEmpty = false;
+      }
     }
   }
 }
 
+/**
+  Serial bytes acted on at once rather than buffered for transmit
+*/
+boolean isControlByte(int b)
+{
+  return b == COMMAND_ESCAPE || b == TX_ABORT || b == TX_ON || b == TX_END
+         || b == FRAME_START;
+}
+
+/**
+  Sends "\nfc:free,read,sent\n" when something has changed since the
+  last report and FLOW_REPORT_MILLIS have passed, or at once if forced.
+*/
+void reportFlow(boolean force)
+{
+  if (!force) {
+    if (serialBytesRead == reportedRead && charsSent == reportedSent)
+      return;
+    if (millis() - lastReportMillis < FLOW_REPORT_MILLIS)
+      return;
+  }
+  hostOut.begin();
+  hostOut.print(F("\nfc:"));
+  hostOut.print(textRoom(*tx));
+  hostOut.print(',');
+  hostOut.print(serialBytesRead);
+  hostOut.print(',');
+  hostOut.print(charsSent);
+  hostOut.print('\n');
+  if (!hostOut.end())
+    return;                   // no room, try again next time
+  reportedRead = serialBytesRead;
+  reportedSent = charsSent;
+  lastReportMillis = millis();
+}
+
+/**
+  Paddle break-in: the tick interrupt has paused buffered CW for the
+  operator.  It carries on once the paddles have been idle for
+  breakinHang msec; with breakinHang 0 the rest of the buffer is
+  dropped instead.
+*/
+void serviceBreakIn()
+{
+  for (byte i = 0; i < CHANNELS; i++) {
+    Channel &c = channels[i];
+    if (!c.morse.paused())
+      continue;
+    if (breakinHang == 0) {
+      c.morse.abort();
+      resetSendBuffer(c);
+    } else if (keyer.active() && i == keyer.get_channel()) {
+      breakinMillis = millis();
+    } else if (millis() - breakinMillis >= breakinHang) {
+      c.morse.resume();
+    }
+  }
+}
+
+/**
+  The paddles key the channel host text goes to.  After ~@n they move
+  over once they are idle, with that channel's keyer speed and weight,
+  and the sidetone goes with them.
+*/
+void followTx()
+{
+  byte from = keyer.get_channel();
+  if (from == tx->n)
+    return;
+  uint8_t sreg = SREG;
+  cli();
+  boolean idle = !keyer.active();
+  if (idle) {
+    channels[from].pttSeq.hold(PTT_KEYER, false);
+    keyer.set_channel(tx->n);
+    SIDETONE_FOLLOW(tx->n);
+  }
+  SREG = sreg;
+  if (idle) {
+    keyer.wpm(tx->cw.key_wpm);
+    keyer.weight(tx->cw.weight);
+  }
+}
+
+/**
+  Buffered CW and the paddle keyer are both clocked by the tick
+  interrupt, which also moves the serial input to serialRing.  A ~
+  command, and the channel the paddles are on, wait while the paddles
+  are keying; otherwise they are serviced on every pass whether or not
+  code is being sent, and another channel always is.  Queued output is
+  passed on to the serial port on every pass as well, and a
+  configuration being saved goes on to the EEPROM as it is ready.  Each
+  pass is timed and the timer interrupts checked for the runtime
+  report.
+*/
 void loop()
 {
-   if ( !keyer.do_paddles() ) do_serial(); 
+   unsigned long now = micros();
+   if (now - loopMicros > loopMax) loopMax = now - loopMicros;
+   loopMicros = now;
+   cwTicks.check(now);
+   for (byte i = 0; i < CHANNELS; i++)
+     channels[i].halfBits.check(now);
+
+   while (cmdReplies && !reportsPending) {  // not in the middle of a report
+     hostOut.print(F("\ncmd:\n")); // Tells N1MM that TX is finished
+     cmdReplies--;
+   }
+   hostOut.service();
+   serviceReports();
+   configStore.service();
+   if (millis() - configMillis >= CONFIG_CHECK_MILLIS) {
+     ConfigRecord r;
+     configMillis = millis();
+     fillConfig(r);
+     configStore.update(r);
+   }
+   serviceBreakIn();
+   followTx();
+   byte k = keyer.get_channel();
+   boolean keying = keyer.busy() && !channels[k].morse.busy();
+   do_serial(keying);
+   for (byte i = 0; i < CHANNELS; i++)
+     if (!keying || i != k) serviceChannel(channels[i]);
+   if (!keying && flowReports) reportFlow(false);
 }
 
-// Handle configuration change commands by changing variables
-// and writing new values to EEPROM.
+// Handle configuration change commands by changing variables.  The
+// loop saves the configuration to EEPROM once it has settled.
 //
 // Configuration change commands are preceded by the ~ character
 //
@@ -252,36 +488,134 @@ void loop()
 // ~Snnns - change CW WPM to nnn
 // ~Unnnu - change CW keyer WPM to nnn
 // ~Dnnnd - change CW dash/dot ratio to nnn/100
+// ~Ennne - change CW Farnsworth (overall) WPM to nnn, 0 = off
+// ~Gnnnng - paddle break-in hang time to nnnn msec, 0 = drop buffer
+// ~Hnnnh - change sidetone pitch to nnn Hz, 0 = off (SIDETONE builds)
+// ~Onnnno - PTT lead time to nnnn msec before the first keying edge
+// ~Xnnnnx - PTT tail time to nnnn msec after the host ends a transmission
+// ~Ynnnny - PTT hang time to nnnn msec after the last CW element
 // ~In    - change CW incr/decr value (1...9)
+// ~Ln    - change serial speed, 1..6 = 9600, 19200, 38400, 57600,
+//          115200, 250000 (takes effect after the reply)
+// ~Q, ~q - flow reports on / off
+// ~R, ~r - runtime report / clear its counters
+// ~Mn..~ - record memory n (1...6) up to the next ~; [ ] # allowed
+// ~Pn    - send memory n
+// ~Nnnnnn - set contest serial number (1...9999)
+// ~@n    - send text and settings to channel n (1, or 1...2 in SO2R builds)
 // ~0     - Set FSK mark = HIGH
 // ~1     - Set FSK mark = LOW
 // ~4     - Set FSK baud to 45.45
 // ~5     - Set FSK baud to 50.0
 // ~7     - Set FSK baud to 75.0
 // ~9     - Set FSK baud to 100.0
+// ~Vnnnnnv - Set FSK baud * 100 (1600...30000), e.g. ~V11000v = 110
+// ~Zn    - FSK stop bits, n = 1, 5 (1.5) or 2
+// ~$n    - FSK USOS, n = 1 off, 2 on, 3 MMTTY style (extra FIGS after space)
+// ~J     - Report keying edge trace (EDGE_TRACE builds)
+// ~j     - Clear keying edge trace (EDGE_TRACE builds)
 // ~?     - Report current configuration
-// ~W     - Save config to EEPROM
+// ~W     - Save config to EEPROM now
 // ~~     - Show command set
 
 void handleConfigurationCommand(byte b)
 {
-  if (weight_string && b >= '0' && b <= '9') {
-    wt_cmd = wt_cmd * 10 + b - '0';
+  // A memory being recorded goes straight to EEPROM.  do_serial() only
+  // reads each byte once the EEPROM is ready for it, so the write never
+  // waits; the rest of a memory, MEMORY_SIZE bytes at most, stays in
+  // the serial receive buffer meanwhile.
+  if (memoryRecord) {
+    int addr = EE_MEMORY_ADDR + (memoryRecord - 1) * MEMORY_SIZE;
+    if (b == COMMAND_ESCAPE) {
+      EEPROM.update(addr + memoryPos, 0);
+      memoryRecord = 0;
+      configurationMode = false;
+    } else if (memoryPos < MEMORY_SIZE - 1) {
+      EEPROM.update(addr + memoryPos, b);
+      memoryPos++;
+    }
     return;
   }
-  if (speed_string &&  b >= '0' && b <= '9') {
-    spd_cmd = spd_cmd * 10 + b - '0';
+  if (numberCmd) {
+    if (b >= '0' && b <= '9') {
+      if (numberArg <= (32767 - 9) / 10) numberArg = numberArg * 10 + b - '0';
+      return;
+    }
+    // anything but the matching lower case letter abandons the command
+    byte cmd = numberCmd;
+    numberCmd = 0;
+    configurationMode = false;
+    if (b != cmd - 'A' + 'a') {
+      hostOut.print(F("\nUnrecognized command.\n"));
+      return;
+    }
+    switch (cmd) {
+      case 'D' : applySetting(SET_WEIGHT, numberArg); break;
+      case 'E' : applySetting(SET_FARNSWORTH, numberArg); break;
+      case 'G' : applySetting(SET_BREAKIN, numberArg); break;
+      case 'H' : applySetting(SET_SIDETONE, numberArg); break;
+      case 'N' : applySetting(SET_CONTEST_NR, numberArg); break;
+      case 'O' : applySetting(SET_PTT_LEAD, numberArg); break;
+      case 'S' : applySetting(SET_WPM, numberArg); break;
+      case 'U' : applySetting(SET_KEY_WPM, numberArg); break;
+      case 'V' : applySetting(SET_BAUD, numberArg); break;
+      case 'X' : applySetting(SET_PTT_TAIL, numberArg); break;
+      case 'Y' : applySetting(SET_PTT_HANG, numberArg); break;
+    }
     return;
   }
-  if (user_speed_string &&  b >= '0' && b <= '9') {
-    spd_cmd = spd_cmd * 10 + b - '0';
+  if (charCmd) {
+    byte cmd = charCmd;
+    byte n = b - '0';
+    charCmd = 0;
+    configurationMode = false;
+    switch (cmd) {
+      case 'I' :
+        applySetting(SET_INCR, n);
+        return;
+      case 'L' :
+        if (b >= SERIAL_SPEED_DEFAULT && b <= SERIAL_SPEED_MAX) {
+          setSerialSpeed(b);
+          return;
+        }
+        break;
+      case 'M' :
+        if (n >= 1 && n <= MEMORY_COUNT) {
+          memoryRecord = n;
+          memoryPos = 0;
+          configurationMode = true;  // until the closing ~
+          return;
+        }
+        break;
+      case 'P' :
+        if (n >= 1 && n <= MEMORY_COUNT) {
+          sendMemory(*tx, n);
+          return;
+        }
+        break;
+      case 'Z' :
+        if (b == '1' || b == '5' || b == '2') {
+          applySetting(SET_STOP_BITS, b == '1' ? STOP_BITS_1 :
+                                      b == '5' ? STOP_BITS_1R5 : STOP_BITS_2);
+          return;
+        }
+        break;
+      case '$' :
+        if (n >= USOS_OFF && n <= USOS_MMTTY_HACK) {
+          applySetting(SET_USOS, n);
+          return;
+        }
+        break;
+      case '@' :
+        if (n >= 1 && n <= CHANNELS) {
+          applySetting(SET_CHANNEL, n);
+          return;
+        }
+        break;
+    }
+    hostOut.print(F("\nUnrecognized command.\n"));
     return;
   }
-  if (incr_char) {
-    int val = b - '0';
-    if (val > 0 && val < 10) CWstruc.incr = val;
-    incr_char = false;
-  }
 
   switch (b) {
     case 'A' : case 'a' :
@@ -297,194 +631,680 @@ void handleConfigurationCommand(byte b)
         configurationMode = false;
         break;
     case 'C' : case 'c' :
-        mode = CW_MODE;
+        setMode(CW_MODE);
         configurationMode = false;
         break;
     case 'F' : case 'f' :
-        mode = FSK_MODE;
+        setMode(FSK_MODE);
         configurationMode = false;
         break;
     case 'T' : case 't' :
-        enable_tune();
+        enable_tune(*tx);
         configurationMode = false;
         break;
     case COMMAND_POLARITY_MARK_HIGH :
-        mark = HIGH;
-        space = LOW;
-        EEPROM.write(EE_POLARITY_ADDR, b);
+        tx->mark = HIGH;
+        tx->space = LOW;
         configurationMode = false;
         break;
     case COMMAND_POLARITY_MARK_LOW :
-        mark = LOW;
-        space = HIGH;
-        EEPROM.write(EE_POLARITY_ADDR, b);
+        tx->mark = LOW;
+        tx->space = HIGH;
         configurationMode = false;
         break;
     case COMMAND_45BAUD :
-        baudrate = 45.45;
-        initTimer();
-        EEPROM.write(EE_SPEED_ADDR, b);
-        configurationMode = false;
-        break;
     case COMMAND_50BAUD :
-        baudrate = 50.0;
-        initTimer();
-        EEPROM.write(EE_SPEED_ADDR, b);
-        configurationMode = false;
-        break;
     case COMMAND_75BAUD :
-        baudrate = 75.0;
-        initTimer();
-        EEPROM.write(EE_SPEED_ADDR, b);
-        configurationMode = false;
-        break;
     case COMMAND_100BAUD :
-        baudrate = 100.0;
-        initTimer();
-        EEPROM.write(EE_SPEED_ADDR, b);
+        setBaud(ConfigStore::legacy_baud(b));
         configurationMode = false;
         break;
-    case 'D' : // start dash/dot ratio
-        weight_string = true;
-        wt_cmd = 0;
+    case 'D' : // dash/dot ratio, Dnnnd
+    case 'E' : // Farnsworth wpm, Ennne
+    case 'G' : // break-in hang time, Gnnnng
+    case 'H' : // sidetone pitch, Hnnnh
+    case 'N' : // contest serial number, Nnnnnn
+    case 'O' : // PTT lead time, Onnnno
+    case 'S' : // computer wpm, Snnns
+    case 'U' : // key (user) wpm, Unnnu
+    case 'V' : // FSK baud * 100, Vnnnnnv
+    case 'X' : // PTT tail time, Xnnnnx
+    case 'Y' : // PTT hang time, Ynnnny
+        numberCmd = b;
+        numberArg = 0;
         return;
-    case 'd' : // end dash/dot ratio
-        weight_string = false;
-        if (wt_cmd >= 250 && wt_cmd <= 350) {
-          CWstruc.weight = wt_cmd / 100;
-          morse.weight(CWstruc.weight);
-        }
-        configurationMode = false;
-        break;
     case 'I' : case 'i' : // incr/dec value
-        incr_char = true;
+    case 'L' : case 'l' : // serial speed
+    case 'M' : case 'm' : // record memory
+    case 'P' : case 'p' : // send memory
+    case 'Z' : case 'z' : // stop bits
+    case '@' :            // channel
+        charCmd = b & ~0x20;  // upper case
         return;
-    case 'S' : // start Speed (wpm)
-        speed_string = true;
-        spd_cmd = 0;
+    case '$' :            // USOS
+        charCmd = b;
         return;
-    case 's' : // end speed
-        speed_string = false;
-        if (spd_cmd >= MIN_CW_WPM && spd_cmd <= MAX_CW_WPM) {
-          CWstruc.cw_wpm = spd_cmd;
-          morse.wpm(CWstruc.cw_wpm);
-        }
+    case 'Q' :
+        flowReports = true;
+        reportFlow(true);
         configurationMode = false;
         break;
-    case 'U' : // start key wpm (user)
-        user_speed_string = true;
-        spd_cmd = 0;
-        return;
-    case 'u' : // end speed
-        user_speed_string = false;
-        if (spd_cmd >= MIN_CW_WPM && spd_cmd <= MAX_CW_WPM) {
-          CWstruc.key_wpm = spd_cmd;
-          keyer.wpm(CWstruc.key_wpm);
-        }
+    case 'q' :
+        flowReports = false;
+        configurationMode = false;
+        break;
+    case 'R' :
+        reportsPending |= REPORT_TELEMETRY;
+        configurationMode = false;
+        break;
+    case 'r' :
+        clearTelemetry();
         configurationMode = false;
         break;
     case COMMAND_DUMP_CONFIG :
-        displayConfiguration();
+        reportsPending |= REPORT_CONFIG;
         configurationMode = false;
         break;
+#ifdef EDGE_TRACE
+    case 'J' :
+        reportsPending |= REPORT_EDGES;
+        configurationMode = false;
+        break;
+    case 'j' :
+        edge_trace_clear();
+        configurationMode = false;
+        break;
+#endif
     case 'W' : case 'w' :
       eeSave();
       configurationMode = false;
       break;
     case COMMAND_ESCAPE :
-      displayConfigurationPrompt();
+      reportsPending |= REPORT_PROMPT;
       configurationMode = false;
       break;
     default :
-      speed_string = false;
-      weight_string = false;
       configurationMode = false;
-      Serial.write("\nUnrecognized command.\n");
+      hostOut.print(F("\nUnrecognized command.\n"));
+  }
+}
+
+/*********************************************************************
+  Settings shared by the ~ commands and binary frames.  Each has a
+  range check in settingTable and a function that applies it.  All
+  but the keyer mode, contest number, sidetone and break-in apply to
+  the channel tx points at.
+***********************************************************************/
+
+boolean setMode(int v)
+{
+  if (v != tx->mode) {
+    // the buffer holds ASCII for CW and Baudot for FSK
+    tx->morse.abort();
+    if (tx->ptt) setPTT(*tx, false);
+    resetSendBuffer(*tx);
+    tx->mode = v;
   }
+  return true;
+}
+
+boolean setWpm(int v)
+{
+  tx->cw.cw_wpm = v;
+  tx->morse.wpm(v);
+  return true;
+}
+
+boolean setKeyWpm(int v)
+{
+  tx->cw.key_wpm = v;
+  if (keyer.get_channel() == tx->n)
+    keyer.wpm(v);
+  return true;
 }
 
+boolean setWeight(int v)
+{
+  tx->cw.weight = v;
+  tx->morse.weight(v);
+  if (keyer.get_channel() == tx->n)
+    keyer.weight(v);
+  return true;
+}
+
+boolean setFarnsworth(int v)
+{
+  if (v != 0 && v < MIN_CW_WPM) return false;
+  tx->cw.farns_wpm = v;
+  tx->morse.farnsworth(v);
+  return true;
+}
+
+boolean setIncr(int v)
+{
+  tx->cw.incr = v;
+  return true;
+}
+
+boolean setKeyer(int v)
+{
+  keyer.set_mode(v);
+  return true;
+}
+
+boolean setBaud(int v)
+{
+  tx->baud100 = v;
+  initTimer(*tx);
+  return true;
+}
+
+boolean setStopBits(int v)
+{
+  tx->stopBits = v;
+  return true;
+}
+
+boolean setUsos(int v)
+{
+  tx->usos = v;
+  return true;
+}
+
+boolean setMark(int v)
+{
+  tx->mark = v;
+  tx->space = !v;
+  return true;
+}
+
+boolean saveSettings(int /*v*/)
+{
+  eeSave();
+  return true;
+}
+
+boolean setContestNr(int v)
+{
+  contestNr = v;
+  return true;
+}
+
+boolean setBreakIn(int v)
+{
+  breakinHang = v;
+  return true;
+}
+
+boolean setPttLead(int v)
+{
+  tx->pttLeadMillis = v;
+  tx->pttSeq.lead(v);
+  return true;
+}
+
+boolean setPttTail(int v)
+{
+  tx->pttTailMillis = v;
+  tx->pttSeq.tail(v);
+  return true;
+}
+
+boolean setPttHang(int v)
+{
+  tx->pttHangMillis = v;
+  tx->pttSeq.hang(v);
+  return true;
+}
+
+boolean setSidetone(int v)
+{
+#ifdef SIDETONE
+  if (v != 0 && v < 100)
+    return false;
+  sidetoneHz = v;
+  sidetone_freq(v);
+  return true;
+#else
+  (void)v;    // no sidetone in this build
+  return false;
+#endif
+}
+
+boolean setChannel(int v)
+{
+  tx = &channels[v - 1];
+  return true;
+}
+
+struct Setting {
+  int lo;
+  int hi;
+  boolean (*apply)(int v);
+};
+
+// indexed by SET_ id
+const Setting settingTable[SET_COUNT] PROGMEM = {
+  { FSK_MODE,   CW_MODE,    setMode },        // SET_MODE
+  { MIN_CW_WPM, MAX_CW_WPM, setWpm },         // SET_WPM
+  { MIN_CW_WPM, MAX_CW_WPM, setKeyWpm },      // SET_KEY_WPM
+  { 250,        350,        setWeight },      // SET_WEIGHT
+  { 0,          MAX_CW_WPM, setFarnsworth },  // SET_FARNSWORTH
+  { 1,          9,          setIncr },        // SET_INCR
+  { IAMBICA,    STRAIGHT,   setKeyer },       // SET_KEYER
+  { MIN_BAUD100, MAX_BAUD100, setBaud },      // SET_BAUD
+  { LOW,        HIGH,       setMark },        // SET_MARK
+  { -32768,     32767,      saveSettings },   // SET_SAVE
+  { 1,          MAX_CONTEST_NR, setContestNr }, // SET_CONTEST_NR
+  { 0,          2000,       setSidetone },    // SET_SIDETONE
+  { 0,          MAX_BREAKIN_HANG_MS, setBreakIn }, // SET_BREAKIN
+  { 0,          MAX_PTT_MS, setPttLead },     // SET_PTT_LEAD
+  { 0,          MAX_PTT_MS, setPttTail },     // SET_PTT_TAIL
+  { 0,          MAX_PTT_MS, setPttHang },     // SET_PTT_HANG
+  { STOP_BITS_1, STOP_BITS_2, setStopBits },  // SET_STOP_BITS
+  { 1,          CHANNELS,   setChannel },     // SET_CHANNEL
+  { USOS_OFF,   USOS_MMTTY_HACK, setUsos },   // SET_USOS
+};
+
 /**
-  Loads speed and polarity from EEPROM
+  Range checks and applies one setting; false if the id is unknown
+  or the value is not allowed.
 */
-void eeLoad()
+boolean applySetting(byte id, int v)
 {
-  byte speedChar = EEPROM.read(EE_SPEED_ADDR);
-  byte polarity  = EEPROM.read(EE_POLARITY_ADDR);
+  if (id >= SET_COUNT)
+    return false;
+  Setting st;
+  memcpy_P(&st, &settingTable[id], sizeof(st));
+  if (v < st.lo || v > st.hi)
+    return false;
+  return st.apply(v);
+}
 
-  if (polarity == COMMAND_POLARITY_MARK_LOW) {
-    mark = LOW;
+/**
+  Takes one byte of a binary settings frame; FRAME_START has already
+  been seen.  The whole frame is read even when its length is wrong so
+  none of it is mistaken for TX text.  Records are applied in order
+  once the check byte has been verified, and one reply is sent.
+*/
+void handleFrameByte(byte b)
+{
+  frameMillis = millis();
+  if (frameGot == 0) {
+    frameLen = b;
+    frameSum = b;
+  } else if (frameGot <= frameLen) {
+    if (frameGot <= sizeof(framePayload))
+      framePayload[frameGot - 1] = b;
+    frameSum += b;
   } else {
-    mark = HIGH;
+    inFrame = false;
+    if ((byte)(frameSum + b) != 0) {
+      sendFrameReply(FRAME_BAD_CHECK, 0);
+    } else if (frameLen % 3 || frameLen > sizeof(framePayload)) {
+      sendFrameReply(FRAME_BAD_LENGTH, 0);
+    } else {
+      unsigned int applied = 0;
+      byte n = frameLen / 3;
+      for (byte i = 0; i < n; i++) {
+        byte *r = &framePayload[i * 3];
+        if (applySetting(r[0], (int16_t)(r[1] | (r[2] << 8))))
+          applied |= 1 << i;
+      }
+      sendFrameReply(applied == (1U << n) - 1 ? FRAME_OK : FRAME_REJECTED,
+                     applied);
+    }
+    return;
   }
-  space = !mark;
+  frameGot++;
+}
 
-  switch (speedChar) {
-    case COMMAND_50BAUD :
-        baudrate = 50.0;
-        break;
-    case COMMAND_75BAUD :
-        baudrate = 75.0;
-        break;
-    case COMMAND_100BAUD :
-        baudrate = 100.0;
-        break;
-    default:
-        baudrate = 45.45;
-        break;
-  }
+void sendFrameReply(byte status, unsigned int applied)
+{
+  byte lo = applied & 0xFF;
+  byte hi = applied >> 8;
+  hostOut.begin();
+  hostOut.write(FRAME_START);
+  hostOut.write(3);
+  hostOut.write(status);
+  hostOut.write(lo);
+  hostOut.write(hi);
+  hostOut.write((byte)-(3 + status + lo + hi));
+  hostOut.end();
+}
 
-  EEPROM.get(EE_CW_STRUC_ADDR, CWstruc);
-  if (CWstruc.cw_wpm < MIN_CW_WPM) CWstruc.cw_wpm = 18;
-  if (CWstruc.cw_wpm > MAX_CW_WPM) CWstruc.cw_wpm = 18;
-  if (CWstruc.key_wpm < MIN_CW_WPM) CWstruc.key_wpm = 18;
-  if (CWstruc.key_wpm > MAX_CW_WPM) CWstruc.key_wpm = 18;
-  if (CWstruc.weight < 2.5) CWstruc.weight = 3.0;
-  if (CWstruc.weight > 3.5) CWstruc.weight = 3.0;
-  if (CWstruc.incr < 1) CWstruc.incr = 2;
-  if (CWstruc.incr > 9) CWstruc.incr = 2;
-  eeSave();
+/**
+  Loads the configuration: the newest valid record or, before one has
+  been written, the FSK speed, polarity and CW settings earlier
+  versions kept at fixed addresses, converted to the current units.
+  Reads only; the loop saves a record once the configuration has
+  settled.
+*/
+void eeLoad()
+{
+  ConfigRecord r;
+
+  if (!configStore.load(r)) {
+    LegacyCWStruc cw;
+    EEPROM.get(EE_CW_STRUC_ADDR, cw);
+    fillConfig(r);
+    r.baud100 = ConfigStore::legacy_baud(EEPROM.read(EE_SPEED_ADDR));
+    r.polarity = EEPROM.read(EE_POLARITY_ADDR);
+    r.cw_wpm = cw.cw_wpm;
+    r.weight = 300;   // blank EEPROM reads as a NaN, which fails the test
+    if (cw.weight >= 2.5 && cw.weight <= 3.5)
+      r.weight = lround(cw.weight * 100);
+    r.incr = cw.incr;
+    r.key_wpm = cw.key_wpm;
+    r.farns_wpm = 0;
+  }
+  useConfig(r);   // out of range values become the defaults
 }
 
+/**
+  Starts saving the configuration now rather than after the quiet
+  period.  The bytes are written by the loop.
+*/
 void eeSave()
 {
-  if (baudrate == 45.45) EEPROM.write(EE_SPEED_ADDR, COMMAND_45BAUD);
-  if (baudrate == 50.0)  EEPROM.write(EE_SPEED_ADDR, COMMAND_50BAUD);
-  if (baudrate == 75.0)  EEPROM.write(EE_SPEED_ADDR, COMMAND_75BAUD);
-  if (baudrate == 100.0) EEPROM.write(EE_SPEED_ADDR, COMMAND_100BAUD);
-  if (mark == LOW) EEPROM.write(EE_POLARITY_ADDR, COMMAND_POLARITY_MARK_LOW);
-  else             EEPROM.write(EE_POLARITY_ADDR, COMMAND_POLARITY_MARK_HIGH);
+  ConfigRecord r;
+  fillConfig(r);
+  configStore.save(r);
+}
+
+/**
+  Fills a configuration record from the current settings.  Only the
+  first channel's are kept; the others start out as copies of it.
+*/
+void fillConfig(ConfigRecord &r)
+{
+  const Channel &c = channels[0];
+  r.seq = 0;
+  r.baud100 = c.baud100;
+  r.stop_bits = c.stopBits;
+  r.usos = c.usos;
+  r.polarity = (c.mark == LOW) ? COMMAND_POLARITY_MARK_LOW : COMMAND_POLARITY_MARK_HIGH;
+  r.serial = serialSpeedChar;
+  r.cw_wpm = c.cw.cw_wpm;
+  r.weight = c.cw.weight;
+  r.incr = c.cw.incr;
+  r.key_wpm = c.cw.key_wpm;
+  r.farns_wpm = c.cw.farns_wpm;
+  r.contest_nr = contestNr;
+}
+
+/**
+  Takes the settings from a configuration record, replacing any that
+  are out of range with the defaults
+*/
+void useConfig(const ConfigRecord &r)
+{
+  byte serialChar = r.serial;
+  if (serialChar < SERIAL_SPEED_DEFAULT || serialChar > SERIAL_SPEED_MAX)
+    serialChar = SERIAL_SPEED_DEFAULT;
+  serialSpeedChar = serialChar;
+  serialSpeed = pgm_read_dword(&serialSpeeds[serialChar - '1']);
+
+  contestNr = (r.contest_nr >= 1 && r.contest_nr <= MAX_CONTEST_NR) ? r.contest_nr : 1;
+
+  Channel &c = channels[0];
+  if (r.polarity == COMMAND_POLARITY_MARK_LOW) {
+    c.mark = LOW;
+  } else {
+    c.mark = HIGH;
+  }
+  c.space = !c.mark;
+
+  if (r.baud100 >= MIN_BAUD100 && r.baud100 <= MAX_BAUD100)
+    c.baud100 = r.baud100;
+  else
+    c.baud100 = DEFAULT_BAUD100;
+  if (r.stop_bits >= STOP_BITS_1 && r.stop_bits <= STOP_BITS_2)
+    c.stopBits = r.stop_bits;
+  else
+    c.stopBits = STOP_BITS_1R5;
+  if (r.usos >= USOS_OFF && r.usos <= USOS_MMTTY_HACK)
+    c.usos = r.usos;
+  else
+    c.usos = USOS_MMTTY_HACK;
+
+  c.cw.cw_wpm = r.cw_wpm;
+  c.cw.weight = r.weight;
+  c.cw.incr = r.incr;
+  c.cw.key_wpm = r.key_wpm;
+  c.cw.farns_wpm = r.farns_wpm;
+  if (c.cw.cw_wpm < MIN_CW_WPM) c.cw.cw_wpm = 18;
+  if (c.cw.cw_wpm > MAX_CW_WPM) c.cw.cw_wpm = 18;
+  if (c.cw.key_wpm < MIN_CW_WPM) c.cw.key_wpm = 18;
+  if (c.cw.key_wpm > MAX_CW_WPM) c.cw.key_wpm = 18;
+  if (c.cw.weight < 250) c.cw.weight = 300;
+  if (c.cw.weight > 350) c.cw.weight = 300;
+  if (c.cw.farns_wpm < 0 || c.cw.farns_wpm > MAX_CW_WPM) c.cw.farns_wpm = 0;
+  if (c.cw.incr < 1) c.cw.incr = 2;
+  if (c.cw.incr > 9) c.cw.incr = 2;
+}
+
+/**
+  Copies the saved settings of one channel to another
+*/
+void copySettings(Channel &to, const Channel &from)
+{
+  to.cw = from.cw;
+  to.baud100 = from.baud100;
+  to.stopBits = from.stopBits;
+  to.usos = from.usos;
+  to.mark = from.mark;
+  to.space = from.space;
+}
 
-  EEPROM.put(EE_CW_STRUC_ADDR, CWstruc);
+/**
+  Switches the host serial port to the speed for '1' ... '6'.  The
+  reply already queued goes out at the old speed first.
+*/
+void setSerialSpeed(byte n)
+{
+  serialSpeedChar = n;
+  serialSpeed = pgm_read_dword(&serialSpeeds[n - '1']);
+  hostOut.begin();
+  hostOut.print(F("\nSerial "));
+  hostOut.print(serialSpeed);
+  hostOut.print('\n');
+  hostOut.end();
+  hostOut.flush();
+  Serial.end();
+  Serial.begin(serialSpeed);
 }
 
 /**
   Init the timer to fire every *half* bit period.  This allows us
   to have 1.5 stop bits if we want.
 */
-void initTimer()
+void initTimer(Channel &c)
 {
-  Timer1.stop();
-  long bitPeriod = (long) ((1.0f / baudrate) * 1000000); //micros
-  Timer1.initialize(bitPeriod / 2.0);
-  Timer1.attachInterrupt(timerISR);
+  c.baudClock.begin(c.baud100);
+  c.halfBitMicros = c.baudClock.half_bit_usec();
+  c.halfBits.period(c.baudClock.half_bit_clocks());
 }
 
 /**
-  The ISR for the half-bit timer is just to set a flag.  We
-  will process in the main loop.
+  The ISRs for the half-bit timer, one compare unit per channel, clock
+  out the FSK bits so that edge timing does not depend on what the
+  main loop, or the other channel, is doing.  step() first, so the
+  next compare is set well before it is due.
 */
-void timerISR()
+void halfBit(Channel &c)
+{
+  c.baudClock.step();
+  c.halfBits.count();
+  processHalfBit(c);
+}
+
+ISR(TIMER1_COMPA_vect)
 {
-  isrFlag = true;
+  halfBit(channels[0]);
+}
+
+#if CHANNELS > 1
+ISR(TIMER1_COMPB_vect)
+{
+  halfBit(channels[1]);
+}
+#endif
+
+/**
+  Timer2 runs in CTC mode at CW_TICK_US and drives the CW element
+  state machines of buffered text and of the paddle keyer.  clk/32
+  gives a 2 usec count on a 16 MHz board.  Timer2 is otherwise only
+  used by analogWrite on pins 3 and 11 and by tone(), neither of which
+  nanoIO uses.  With the sidetone built in, its PWM takes Timer2 over
+  and calls cw_tick() itself.
+*/
+void initTickTimer()
+{
+  cwTicks.period(CW_TICK_US * (F_CPU / 1000000L));
+#ifdef SIDETONE
+  sidetone_init();
+  sidetone_freq(sidetoneHz);
+#else
+  uint8_t sreg = SREG;
+  cli();
+  TCCR2A = _BV(WGM21);
+  TCCR2B = _BV(CS21) | _BV(CS20);
+  TCNT2  = 0;
+  OCR2A  = (CW_TICK_US / 2) - 1;
+  TIMSK2 = _BV(OCIE2A);
+  SREG = sreg;
+#endif
 }
 
 /**
-  Displays the configuration options on the console
+  Called every CW_TICK_US from the Timer2 interrupt.  Serial input is
+  moved after the keying, so it never delays an edge.
 */
-void displayConfigurationPrompt()
+void cw_tick()
 {
+  cwTicks.count();
+  for (byte i = 0; i < CHANNELS; i++)
+    channelTick(channels[i], i == keyer.get_channel());
+  serialTick();
+}
 
-  Serial.write("\
+/**
+  One channel's share of the tick.  On the channel the paddles are on,
+  buffered text and the paddles take turns on its CW line: each one
+  starts only while the other is idle.  Both hold PTT while they have
+  something to send, and neither keys until the sequencer's lead time
+  is up.
+*/
+void channelTick(Channel &c, boolean paddles)
+{
+  if (paddles && c.morse.busy() && keyer.active())
+    c.morse.pause();            // break-in, at the end of the element
+  if (c.pttSeq.tick() && c.mode == FSK_MODE)
+    fsk_line(c.n, c.space, 0);  // PTT has just dropped
+  if (c.pttSeq.ready()) {
+    if (c.tuneKey) {
+      c.tuneKey = false;
+      cw_line(c.n, HIGH, 0);
+    }
+    if (!paddles || !keyer.busy())
+      c.morse.tick();
+    if (paddles && (!c.morse.busy() || c.morse.held()))
+      keyer.tick();
+  } else if (paddles)
+    keyer.paddle_edge();        // a change the debounce lockout hid
+  c.pttSeq.hold(PTT_MORSE, c.morse.busy());
+  if (paddles)
+    c.pttSeq.hold(PTT_KEYER, keyer.active());
+}
+
+#ifndef SIDETONE
+ISR(TIMER2_COMPA_vect)
+{
+  cw_tick();
+}
+#endif
+
+/**
+  Paddle contacts raise a pin change interrupt, enabled by the keyer
+  for LP_in and RP_in; only the vectors for their ports are used.
+*/
+#if LP_in < 8 || RP_in < 8
+ISR(PCINT2_vect)
+{
+  keyer.paddle_edge();
+}
+#endif
+#if (LP_in >= 8 && LP_in < 14) || (RP_in >= 8 && RP_in < 14)
+ISR(PCINT0_vect)
+{
+  keyer.paddle_edge();
+}
+#endif
+#if LP_in >= 14 || RP_in >= 14
+ISR(PCINT1_vect)
+{
+  keyer.paddle_edge();
+}
+#endif
+
+/**
+  Prints pending reports a part at a time, as many parts as the
+  output queue has room for, so that every part goes out whole however
+  long the report.  Each leaves REPORT_SPARE bytes free for echo and
+  short replies.  A part that did not fit is tried again once the
+  queue has emptied.
+*/
+void serviceReports()
+{
+  while (reportsPending) {
+    if (reportWait && !hostOut.empty())
+      return;
+    byte r = reportsPending & -reportsPending;
+    boolean more = false;
+    hostOut.begin(REPORT_SPARE);
+    switch (r) {
+      case REPORT_CONFIG :
+        more = displayConfiguration(reportPart);
+        break;
+      case REPORT_PROMPT :
+        more = displayConfigurationPrompt(reportPart);
+        break;
+      case REPORT_READY :
+        hostOut.print(F("cmd:\n")); // Tell N1MM we are in "RX" mode.  This will be sent
+        // at the end of transmission.
+        break;
+      case REPORT_TELEMETRY :
+        more = displayTelemetry(reportPart);
+        break;
+#ifdef EDGE_TRACE
+      case REPORT_EDGES :
+        more = edge_trace_dump(hostOut, reportPart);
+        break;
+#endif
+    }
+    if (!hostOut.end(false)) {
+      reportWait = true;
+      return;
+    }
+    reportWait = false;
+    if (more) {
+      reportPart++;
+    } else {
+      reportsPending &= ~r;
+      reportPart = 0;
+    }
+  }
+}
+
+/**
+  Displays the configuration options on the console, the common ones
+  and then those of the build; true while there is more to come
+*/
+boolean displayConfigurationPrompt(byte part)
+{
+  if (part == 0) {
+    hostOut.print(F("\
 \nCmd ~...\n\
  C,c   CW mode\n\
  F,f   FSK mode\n\
@@ -492,7 +1312,16 @@ void displayConfigurationPrompt()
  Snnns computer wpm 10...100\n\
  Unnnu key (user) wpm 10...100\n\
  Dnnnd dash/dot 250...350 (2.5...3.5)\n\
+ Ennne Farnsworth wpm, 0 off\n\
+ G..g  break-in hang msec, 0 drop\n\
+ O..o X..x Y..y PTT lead, tail, hang msec\n\
  In    CW incr (1..9)\n\
+ Ln    serial 1..6 9600...250000\n\
+ Q,q   flow reports on, off\n\
+ R,r   runtime report, clear\n\
+ Mn..~ record memory 1..6, # = number\n\
+ Pn    send memory 1..6\n\
+ N..n  contest number\n\
  A,a   IambicA\n\
  B,b   IambicB\n\
  K,k   Straight key\n\
@@ -502,71 +1331,222 @@ void displayConfigurationPrompt()
  5     50 baud\n\
  7     75 baud\n\
  9     100 baud\n\
+ V..v  baud * 100, 1600...30000\n\
+ Zn    stop bits 1, 5 (1.5), 2\n\
+ $n    USOS 1 off, 2 on, 3 MMTTY\n\
  ?     Show config\n\
  W     Write EEPROM\n\
- ~     Show cmds\n");
+ ~     Show cmds\n"));
+    return true;
+  }
+#ifdef SO2R
+  hostOut.print(F(" @n    channel 1, 2 for text, settings\n"));
+#endif
+#ifdef SIDETONE
+  hostOut.print(F(" Hnnnh sidetone Hz, 0 off\n"));
+#endif
+#ifdef EDGE_TRACE
+  hostOut.print(F(" J,j   Edge trace dump, clear\n"));
+#endif
+  return false;
+}
+
+#define CHANNEL_PARTS 3   // of displayChannel()
+
+/**
+  Prints part of the current configuration to the console: the
+  version, each channel's settings and then the common ones.  True
+  while there is more to come.
+*/
+boolean displayConfiguration(byte part)
+{
+  if (part == 0) {
+    hostOut.print(F("\nnanoIO " VERSION "\n"));
+    return true;
+  }
+  part--;
+  if (part < CHANNELS * CHANNEL_PARTS) {
+    displayChannel(channels[part / CHANNEL_PARTS], part % CHANNEL_PARTS);
+    return true;
+  }
+#ifdef SIDETONE
+  hostOut.print(F("Sidetone: "));
+  if (sidetoneHz) {
+    hostOut.print(sidetoneHz); hostOut.print(F(" Hz\n"));
+  } else
+    hostOut.print(F("off\n"));
+#endif
+  hostOut.print(F("Break-in: "));
+  if (breakinHang) {
+    hostOut.print(breakinHang); hostOut.print(F(" msec hang\n"));
+  } else
+    hostOut.print(F("drop buffer\n"));
+  hostOut.print(F("Contest nr: ")); hostOut.print(contestNr);
+  hostOut.print(F("\nSerial: ")); hostOut.print(serialSpeed);
+  if (flowReports) hostOut.print(F(", flow reports"));
+  if (hostOut.dropped()) {
+    hostOut.print(F(", output dropped ")); hostOut.print(hostOut.dropped());
+  }
+  hostOut.print('\n');
+  return false;
 }
 
 /**
-  Prints the current configuration the console
+  Prints a line of one channel's part of the configuration: the mode
+  and FSK settings, then CW, then PTT
 */
-void displayConfiguration()
+void displayChannel(Channel &c, byte part)
+{
+  switch (part) {
+    case 0 : displayChannelFSK(c); break;
+    case 1 : displayChannelCW(c); break;
+    case 2 : displayChannelPTT(c); break;
+  }
+}
+
+void displayChannelFSK(Channel &c)
 {
-  Serial.write("\nnanoIO ");
-  Serial.write(VERSION);
-  Serial.write("\nMode: ");
-  if (mode == FSK_MODE) Serial.write("FSK");
-  else Serial.write("CW");
-  Serial.write("\n");
-  Serial.write("FSK: "); Serial.write("Baud: "); Serial.print(baudrate);
-  Serial.write(", Mark ");
-  if (mark == LOW) {
-    Serial.write("LOW");
+#if CHANNELS > 1
+  hostOut.print(F("Channel ")); hostOut.print(c.n + 1);
+  if (&c == tx) hostOut.print(F(", selected"));
+  hostOut.print('\n');
+#endif
+  if (c.mode == FSK_MODE) hostOut.print(F("Mode: FSK\nFSK: Baud: "));
+  else hostOut.print(F("Mode: CW\nFSK: Baud: "));
+  hostOut.print(c.baud100 / 100);
+  hostOut.print('.');
+  if (c.baud100 % 100 < 10) hostOut.print('0');
+  hostOut.print(c.baud100 % 100);
+  hostOut.print(F(" (")); hostOut.print(c.baudClock.rate(), 3);
+  hostOut.print(F("), "));
+  if (c.stopBits == STOP_BITS_1) hostOut.print('1');
+  else if (c.stopBits == STOP_BITS_2) hostOut.print('2');
+  else hostOut.print(F("1.5"));
+  hostOut.print(F(" stop"));
+  if (c.usos == USOS_OFF) hostOut.print(F(", USOS off"));
+  else if (c.usos == USOS_ON) hostOut.print(F(", USOS on"));
+  else hostOut.print(F(", USOS MMTTY"));
+  if (c.mark == LOW) {
+    hostOut.print(F(", Mark LOW\n"));
   } else {
-    Serial.write("HIGH");
+    hostOut.print(F(", Mark HIGH\n"));
   }
-  Serial.write("\n");
-  Serial.write("CW: "); Serial.write("WPM: "); Serial.print(CWstruc.cw_wpm);
-  Serial.write("/"); Serial.print(CWstruc.key_wpm);
-  Serial.write(", dash/dot "); Serial.print(CWstruc.weight);
-  Serial.write(", incr "); Serial.print(CWstruc.incr); Serial.write(", ");
-  if (keyer.get_mode() == STRAIGHT) Serial.print("Straight");
-  else if (keyer.get_mode() == IAMBICA) Serial.print("IambicA");
-  else Serial.print("IambicB");
-  Serial.write(" keyer\n");
+}
+
+void displayChannelCW(Channel &c)
+{
+  hostOut.print(F("CW: WPM: ")); hostOut.print(c.cw.cw_wpm);
+  hostOut.print('/'); hostOut.print(c.cw.key_wpm);
+  hostOut.print(F(", dash/dot ")); hostOut.print(c.cw.weight / 100);
+  hostOut.print('.');
+  if (c.cw.weight % 100 < 10) hostOut.print('0');
+  hostOut.print(c.cw.weight % 100);
+  if (c.cw.farns_wpm) {
+    hostOut.print(F(", Farnsworth ")); hostOut.print(c.cw.farns_wpm);
+  }
+  hostOut.print(F(", incr ")); hostOut.print(c.cw.incr);
+  if (keyer.get_mode() == STRAIGHT) hostOut.print(F(", Straight keyer\n"));
+  else if (keyer.get_mode() == IAMBICA) hostOut.print(F(", IambicA keyer\n"));
+  else hostOut.print(F(", IambicB keyer\n"));
+}
+
+void displayChannelPTT(Channel &c)
+{
+  hostOut.print(F("PTT: lead ")); hostOut.print(c.pttLeadMillis);
+  hostOut.print(F(", tail ")); hostOut.print(c.pttTailMillis);
+  hostOut.print(F(", hang ")); hostOut.print(c.pttHangMillis);
+  hostOut.print(F(" msec\n"));
+}
+
+/**
+  Runtime report: the longest pass of the main loop, timer interrupts
+  lost to others held off too long, how full the send buffer and the
+  serial port have been, characters sent in each mode, and RAM.  In
+  two parts; true after the first.
+*/
+boolean displayTelemetry(byte part)
+{
+  if (part) {
+    displaySent();
+    return false;
+  }
+  hostOut.print(F("\nLoop max ")); hostOut.print(loopMax);
+  hostOut.print(F(" usec, missed ticks ")); hostOut.print(cwTicks.missed());
+  hostOut.print(F(", half-bits "));
+  for (byte i = 0; i < CHANNELS; i++) {
+    if (i) hostOut.print('/');
+    hostOut.print(channels[i].halfBits.missed());
+  }
+  hostOut.print(F("\nBuffer peak "));
+  for (byte i = 0; i < CHANNELS; i++) {
+    if (i) hostOut.print('/');
+    hostOut.print(channels[i].sendBuffer.peak());
+  }
+  hostOut.print(F(", serial peak ")); hostOut.print(serialPeak);
+  hostOut.print(F(", full ")); hostOut.print(serialFull);
+  hostOut.print(F(", text dropped ")); hostOut.print(textDropped);
+  hostOut.print(F(", output dropped ")); hostOut.print(hostOut.dropped());
+  hostOut.print('\n');
+  return true;
+}
+
+void displaySent()
+{
+  hostOut.print(F("Sent CW ")); hostOut.print(cwSent);
+  hostOut.print(F(", FSK ")); hostOut.print(fskSent);
+  hostOut.print(F(" + ")); hostOut.print(fskShifts);
+  hostOut.print(F(" shifts, ")); hostOut.print(fskShiftsSaved);
+  hostOut.print(F(" saved"));
+  hostOut.print(F("\nRAM free ")); hostOut.print(ram_free());
+  hostOut.print(F(", stack unused ")); hostOut.print(stack_unused());
+  hostOut.print('\n');
+}
+
+/**
+  Starts the loop time, missed interrupts and peaks again
+*/
+void clearTelemetry()
+{
+  loopMax = 0;
+  cwTicks.clear();
+  for (byte i = 0; i < CHANNELS; i++) {
+    channels[i].halfBits.clear();
+    channels[i].sendBuffer.clear_peak();
+  }
+  serialPeak = 0;
+  serialFull = 0;
+  textDropped = 0;
 }
 
 /******************************************************************
    handle CW characters in buffer
 */
-void send_next_CW_char()
+void send_next_CW_char(Channel &c)
 {
-  if (sendBufferBytes > 0) {
-    byte chr = sendBufferArray[0];
-    for (int i = 0; i < sendBufferBytes; i++) {
-      sendBufferArray[i] = sendBufferArray[i + 1];
-    }
-    sendBufferBytes--;
+  if (!c.sendBuffer.empty() && c.morse.ready()) {
+    byte chr = c.sendBuffer.get();
+    charsSent++;
     if (chr == '^') {
-      CWstruc.cw_wpm += CWstruc.incr;
-      if (CWstruc.cw_wpm > 100) CWstruc.cw_wpm = 100;
-      morse.wpm(CWstruc.cw_wpm);
+      c.cw.cw_wpm += c.cw.incr;
+      if (c.cw.cw_wpm > 100) c.cw.cw_wpm = 100;
+      c.morse.wpm(c.cw.cw_wpm);
       return;
     }
     if (chr == '|') {
-      CWstruc.cw_wpm -= CWstruc.incr;
-      if (CWstruc.cw_wpm < 5) CWstruc.cw_wpm = 5;
-      morse.wpm(CWstruc.cw_wpm);
+      c.cw.cw_wpm -= c.cw.incr;
+      if (c.cw.cw_wpm < 5) c.cw.cw_wpm = 5;
+      c.morse.wpm(c.cw.cw_wpm);
       return;
     }
-    morse.send(chr, CW_PIN);
+    c.morse.send(chr);
+    cwSent++;
     echo(chr);
   }
 }
 
 /******************************************************************
-  This called every half-bit period to figure out what to bit-bang
-  out the FSK pin.  It is basically an incremental counter that
+  This called from the timer interrupt every half-bit period to
+  figure out what to bit-bang out the FSK pin.  It is basically an incremental counter that
   counts half bit periods and toggles the bits of the baudot character
   as needed.  It bangs out the start bit, five symbol bits, and the
   stop bit, which is 1.5 bits long (hence the need to have a timer
@@ -576,250 +1556,354 @@ void send_next_CW_char()
         ||Start | LSB |  X  |  X  |  X  | MSB | Stop    ||
   bitPos:   -1     0     1     2     3     4      5
 ******************************************************************/
-int sendingChar = LTRS_SHIFT; // default--this is the "diddle character"
-int stopBitCounter = 0; // counts half-bits for stop bit
-int bitPos = START_BIT_POS;        // -1 = Start bit
-bool midBit = false;    // used as like an ignore flag--we usually don't
-// toggle state in the middle of a bit.  The exception
-// is the stop bit, which is often 1.5 bits long.
-void processHalfBit() {
-
-  if (!ptt)  //not transmitting, so just return--there's nothing to send.
+void processHalfBit(Channel &c) {
+
+  //not transmitting, so just return--there's nothing to send.
+  if (!c.ptt || c.txEndReached || c.mode != FSK_MODE || !c.pttSeq.ready())
     return;
 
-  if (midBit) {
-    midBit = false; // reset the flag.  Next time we need to send the next bit.
+  if (c.midBit) {
+    c.midBit = false; // reset the flag.  Next time we need to send the next bit.
     return;
   }
 
   // it's time to bang out the next bit.  We check for the special cases
   // first.  If it's a start bit we always sent SPACE and if its a STOP bit
   // we always send MARK.
-  if (bitPos == START_BIT_POS) {  // we have to send a start bit
-
-// If it is time to send a start bit, we grab the next character to send so
-// that it is ready the next time through the loop.  The next character
-// might be the TX_END_FLAG, in which case we need to turn off the transmitter.
-    sendingChar = getNextSendChar();
+  if (c.bitPos == START_BIT_POS) {  // we have to send a start bit
+
+// If it is time to send a start bit, we take the character the main loop
+// staged.  It might be the TX_END_FLAG, in which case the main loop needs
+// to turn off the transmitter.  If nothing is staged the typist is slow
+// and we idle on LTRS or FIGS depending on what state we are in.
+    c.sendingChar = c.stagedChar;
+    if (c.sendingChar == FSK_EMPTY) {
+      if (c.currentShiftState == SHIFT_UNKNOWN)
+        c.currentShiftState = LTRS_SHIFT;  //send LTRS idle if we haven't sent anything on this TX
+      c.sendingChar = c.currentShiftState;
+    } else
+      c.stagedChar = FSK_EMPTY;
 
-    if (ptt) {
-      if (sendingChar == TX_END_FLAG) { //end of data to send
-        setPTT(false);
-        return;
-      } else {
-        digitalWrite(FSK_PIN, space);  //start bit is always space
-        bitPos++;
-        midBit = true;
-      }
+    if (c.sendingChar == TX_END_FLAG) { //end of data to send
+      fsk_line(c.n, c.mark, 0);  // the last stop bit runs on until PTT drops
+      c.txEndReached = true;
+      return;
     }
+    fsk_line(c.n, c.space, 2 * c.halfBitMicros);  //start bit is always space
+    c.bitPos++;
+    c.midBit = true;
   }
-  else if (bitPos == STOP_BIT_POS) { // we have to send a stop bit
-    if (stopBitCounter == 0) {
-      digitalWrite(FSK_PIN, mark);
-      stopBitCounter = stopBits;  //this determines # of half-bit periods we stay in stop bit
+  else if (c.bitPos == STOP_BIT_POS) { // we have to send a stop bit
+    if (c.stopBitCounter == 0) {
+      fsk_line(c.n, c.mark, (c.stopBits + 1) * c.halfBitMicros);
+      c.stopBitCounter = c.stopBits;  //this determines # of half-bit periods we stay in stop bit
     } else { // already in stop bit, just decrement
 // stopBitCounter counts half-bit periods.  2 ==> one stop bit
 //                                          3 ==> 1.5 stop bits
 //                                          4 ==> two stop bits
-      stopBitCounter--;
-      if (stopBitCounter == 0){ // end of stop bit period
-        bitPos = START_BIT_POS;  // move on to start bit of next char
-
-//  If we just sent an explicit LTRS or FIGS shift, obviously we are in that state.  If USOS is turned on and we
-//  have sent a space character, we are implicitly in LTRS shift.
-        if (sendingChar == LTRS_SHIFT || (usos == USOS_ON && sendingChar == 0x04) ) { //0x04 = Baudot space
-          currentShiftState = LTRS_SHIFT;
-        } else if (sendingChar == FIGS_SHIFT) {
-          currentShiftState = FIGS_SHIFT;
-        }
+      c.stopBitCounter--;
+      if (c.stopBitCounter == 0){ // end of stop bit period
+        c.bitPos = START_BIT_POS;  // move on to start bit of next char
       }
     }
   } else {
 // We are not sending a stop/start bit, so we send the next bit of the of the character.
-    bool b = (sendingChar & (0x01 << bitPos));  //LSB first
-    if (b) {
-      digitalWrite(FSK_PIN, mark);
-    }
-    else {
-      digitalWrite(FSK_PIN, space);
-    }
-    bitPos++;
-    midBit = true;
+    bool b = (c.sendingChar & (0x01 << c.bitPos));  //LSB first
+    fsk_line(c.n, b ? c.mark : c.space, 2 * c.halfBitMicros);
+    c.bitPos++;
+    c.midBit = true;
   }
 }
 
 /**
   Reset character buffer.  This is a helper routine when stop the
   transmitter so that everything is back to initial states ready
-  to bang out the first character.
+  to bang out the first character.  Only call it with the half-bit
+  interrupt idle (ptt false).
 */
-void resetChar()
+void resetChar(Channel &c)
 {
-  sendingChar = LTRS_SHIFT;
-  stopBitCounter = 0;
-  bitPos = START_BIT_POS;
-  midBit = false;
+  c.sendingChar = LTRS_SHIFT;
+  c.stagedChar = FSK_EMPTY;
+  c.stopBitCounter = 0;
+  c.bitPos = START_BIT_POS;
+  c.midBit = false;
+  c.currentShiftState = SHIFT_UNKNOWN;
+  c.txEndReached = false;
 }
 
 /**
   Wipes the send buffer. Helper function for aborting
   a transmission.
 */
-void resetSendBuffer()
+void resetSendBuffer(Channel &c)
 {
-  for (int i = 0; i < SEND_BUFFER_SIZE; i++)
-    sendBufferArray[i] = 0;
-  sendBufferBytes = 0;
+  c.sendBuffer.clear();
+  c.encShiftState = SHIFT_UNKNOWN;
+  c.encLastCode = LTRS_SHIFT;
 }
 
 /**
-  Adds a new byte to the transmit text buffer.  These
-  are *ASCII* bytes from the terminal, not Baudot.
+  Characters that are sure to fit in the send buffer.  In FSK mode
+  a character may need a shift queued ahead of it, so it counts twice.
 */
-void addToSendBuffer(byte newByte)
+unsigned int textRoom(Channel &c)
 {
-  if (sendBufferBytes < SEND_BUFFER_SIZE) {
-    sendBufferBytes++;
-    sendBufferArray[sendBufferBytes - 1] = newByte;
-  }
+  if (c.mode == FSK_MODE)
+    return c.sendBuffer.room() / 2;
+  return c.sendBuffer.room();
 }
 
 /**
-  Gets the next Baudot (5-bit) char from the buffer.  This
-  function will return LTRS or FIGS shift characters when
-  needed depending on the current shift state and USOS setting.
+  Adds a new byte to the transmit text buffer.  These
+  are *ASCII* bytes from the terminal.  In CW mode they are
+  buffered as they are; in FSK mode they are encoded here, once,
+  into the Baudot codes the half-bit interrupt will send.
 */
-byte getNextSendChar()
+void addToSendBuffer(Channel &c, byte newByte)
 {
+  if (c.mode == FSK_MODE)
+    encodeBaudot(c, newByte);
+  else if (newByte < ' ')
+    c.sendBuffer.put(' ');
+  else
+    c.sendBuffer.put(newByte);
+}
 
-  byte rVal = LTRS_SHIFT;  //default "idle" or "diddles" when nothing to send
-
-  if (sendBufferBytes > 0) {  // there is still data in buffer to send
-    byte asciiByte = sendBufferArray[0];
+/**
+  Queues message memory n (1 ... MEMORY_COUNT) from EEPROM as if the
+  host had sent it, with the contest number in place of MEMORY_NUMBER.
+  The memory is sent whole or, if the buffer cannot take all of it,
+  not at all.
+*/
+void sendMemory(Channel &c, byte n)
+{
+  int addr = EE_MEMORY_ADDR + (n - 1) * MEMORY_SIZE;
+  byte len, b;
+  unsigned int need = 0;
+  boolean numbered = false;
+
+  for (len = 0; len < MEMORY_SIZE; len++) {
+    b = EEPROM.read(addr + len);
+    if (b == 0 || b == 0xFF)  // end, or never recorded
+      break;
+    if (b == MEMORY_NUMBER)
+      need += 4;
+    else if (b != TX_ON && b != TX_END)
+      need++;
+  }
+  if (need > textRoom(c)) {
+    hostOut.begin();
+    hostOut.print(F("\nNo room for memory "));
+    hostOut.print(n);
+    hostOut.print('\n');
+    hostOut.end();
+    return;
+  }
 
-    if (currentShiftState != LTRS_SHIFT && requiresLetters(asciiByte)) {
-      //echo('_');
-      return LTRS_SHIFT;
-    }
-    else if (currentShiftState != FIGS_SHIFT && requiresFigures(asciiByte)) {
-      //echo('^');
-      return FIGS_SHIFT;
-    }
-    // Special "robust" USOS case--send FIGS after a space even if already in FIGS state and next
-    // character requires FIGS shift.  Note: when this is called
-    // sendingChar is the char we just *finished* sending
-    else if ( (usos == USOS_MMTTY_HACK) && 
-              (currentShiftState != LTRS_SHIFT) && 
-              requiresFigures(asciiByte) && 
-              (sendingChar == 0x04) ) {
-//echo('^');
-      return FIGS_SHIFT;
-    }
-    else {
-//we don't need to send a shift character.  Just find the baudot equiv of the ascii symbol and return it.
-      rVal = asciiToBaudot[asciiByte];
-      lastAsciiByteSent = asciiByte;
-      sendBufferBytes--;
-      if (sendBufferBytes > 0) {
-        for (int i = 0; i < sendBufferBytes; i++) {
-          sendBufferArray[i] = sendBufferArray[i + 1];
-        }
-      }
-      echo(asciiByte);
+  for (byte i = 0; i < len; i++) {
+    b = EEPROM.read(addr + i);
+    switch (b) {
+      case TX_ON :
+        c.endWhenBufferEmpty = false;
+        setPTT(c, true);
+        break;
+      case TX_END :
+        c.endWhenBufferEmpty = true;
+        break;
+      case MEMORY_NUMBER :
+        addContestNr(c);
+        numbered = true;
+        break;
+      default :
+        addToSendBuffer(c, b);
     }
   }
-  else {
-// the buffer is empty
-    if (endWhenBufferEmpty) {
-      rVal = TX_END_FLAG;  // signals to stop the TX
-    } else {
-// slow typist?
-      if (currentShiftState == SHIFT_UNKNOWN) {
-        rVal = LTRS_SHIFT;  //send LTRS idle if we haven't sent anything on this TX
-      }
-      else {
-        rVal = currentShiftState; // idle on LTRS or FIGS depending on what state we are in
-      }
+  if (numbered && contestNr < MAX_CONTEST_NR)
+    setContestNr(contestNr + 1);
+}
+
+/**
+  Queues the contest serial number, at least three digits: 001
+*/
+void addContestNr(Channel &c)
+{
+  unsigned int div = 1000;
+  boolean digits = false;
+  for (byte i = 0; i < 4; i++) {
+    byte d = (contestNr / div) % 10;
+    if (d || digits || div <= 100) {
+      addToSendBuffer(c, '0' + d);
+      digits = true;
     }
+    div /= 10;
   }
-  return rVal;
 }
 
+/**
+  Queues the Baudot code for an ASCII byte, preceded by a LTRS or
+  FIGS shift when needed depending on the shift state the transmitter
+  will be in and the USOS setting.  The code keeps its BAUDOT_LTRS /
+  BAUDOT_FIGS class bits for the echo and for the start of a
+  transmission.
+*/
+void encodeBaudot(Channel &c, byte asciiByte)
+{
+  byte entry = baudotEntry(asciiByte);
+
+  if (c.encShiftState != LTRS_SHIFT && (entry & BAUDOT_LTRS)) {
+    queueBaudot(c, LTRS_SHIFT);
+  }
+  else if (c.encShiftState != FIGS_SHIFT && (entry & BAUDOT_FIGS)) {
+    queueBaudot(c, FIGS_SHIFT);
+  }
+  // Special "robust" USOS case--send FIGS after a space even if already in FIGS state and next
+  // character requires FIGS shift.
+  // It is marked to be kept, see getNextSendChar().
+  else if ( (c.usos == USOS_MMTTY_HACK) && 
+            (entry & BAUDOT_FIGS) && 
+            (c.encLastCode == 0x04) ) {
+    queueBaudot(c, FIGS_SHIFT | BAUDOT_KEEP);
+  }
 
-/*
-  returns whether or not this is a "letter".  Letters require LTRS
-  shift preceding the byte if currently in FIGS mode.
+  if (asciiByte >= 'a' && asciiByte <= 'z')
+    entry |= BAUDOT_LOWER;
+  queueBaudot(c, entry);
+}
+
+/**
+  Queues one code and keeps encShiftState in step with it.  If it is
+  an explicit LTRS or FIGS shift, obviously we will be in that state.
+  If USOS is turned on and it is a space character, we will implicitly
+  be in LTRS shift.
 */
-boolean requiresLetters(byte asciiByte)
+void queueBaudot(Channel &c, byte entry)
 {
-  return (asciiByte >= 'A' && asciiByte <= 'Z')
-         || (asciiByte >= 'a' && asciiByte <= 'z');
+  byte code = entry & BAUDOT_CODE;
+  c.encShiftState = nextShiftState(c, c.encShiftState, code);
+  c.encLastCode = code;
+  c.sendBuffer.put(entry);
+}
 
+byte nextShiftState(Channel &c, byte state, byte code)
+{
+  if (code == LTRS_SHIFT || (c.usos == USOS_ON && code == 0x04))  //0x04 = Baudot space
+    return LTRS_SHIFT;
+  if (code == FIGS_SHIFT)
+    return FIGS_SHIFT;
+  return state;
 }
 
 /**
-  Helper function to find out whether a particular byte
-  needs the FIGS shift preceeding it.
+  Gets the next Baudot (5-bit) char from the buffer.  Shifts were
+  decided when the text was queued, so this normally just takes the
+  next code.  The exception is the start of a transmission, where the
+  shift is unknown or the interrupt has idled on LTRS: if the code
+  needs the other shift, that shift goes out ahead of it.
+
+  Looking ahead, a queued shift the transmitter is already in is
+  dropped: after idling on that shift, or where a space under ~$2 has
+  already made it LTRS but the text was queued under another setting.
+  The MMTTY style FIGS after a space is meant to be redundant and is
+  kept.  It runs in the main loop one character ahead of the half-bit
+  interrupt, and returns FSK_EMPTY when there is nothing to send yet.
 */
-boolean requiresFigures(byte asciiByte)
+byte getNextSendChar(Channel &c)
 {
-  return !requiresLetters(asciiByte)
-         && (asciiByte != ASCII_NULL) //null
-         && (asciiByte != ASCII_LF)   //LF
-         && (asciiByte != ASCII_CR)
-         && (asciiByte != ' ');
+
+  byte rVal = FSK_EMPTY;  //the interrupt will idle on "diddles"
+
+  while (!c.sendBuffer.empty()) {
+    byte entry = c.sendBuffer.peek();
+    byte code = entry & BAUDOT_CODE;
+    if ((code != LTRS_SHIFT && code != FIGS_SHIFT) ||
+        code != c.currentShiftState || (entry & BAUDOT_KEEP))
+      break;
+    c.sendBuffer.get();
+    fskShiftsSaved++;
+  }
+
+  if (!c.sendBuffer.empty()) {  // there is still data in buffer to send
+    byte entry = c.sendBuffer.peek();
+
+    if ((entry & BAUDOT_LTRS) && c.currentShiftState != LTRS_SHIFT) {
+      rVal = LTRS_SHIFT;
+    }
+    else if ((entry & BAUDOT_FIGS) && c.currentShiftState != FIGS_SHIFT) {
+      rVal = FIGS_SHIFT;
+    }
+    else {
+      rVal = entry & BAUDOT_CODE;
+      c.sendBuffer.get();
+      if (rVal != LTRS_SHIFT && rVal != FIGS_SHIFT) {
+        charsSent++;
+        fskSent++;
+        byte ascii = baudotEcho(entry);
+        if (ascii) echo(ascii);
+      }
+    }
+    if (rVal == LTRS_SHIFT || rVal == FIGS_SHIFT)
+      fskShifts++;
+    c.currentShiftState = nextShiftState(c, c.currentShiftState, rVal);
+  }
+  else if (c.endWhenBufferEmpty) {
+// the buffer is empty
+    rVal = TX_END_FLAG;  // signals to stop the TX
+  }
+  return rVal;
 }
 
 
 /**
-  Turns the PTT on or off and applies any delays that might exist.
+  Takes or lets go of the transmitter for the host.  PTT itself is
+  switched by the sequencer from the tick interrupt: in FSK mode the
+  half-bit interrupt holds the first start bit, in mark, until the
+  lead time is up, and the tail runs on after the last stop bit.
+  Nothing here waits.
 */
-void setPTT(byte b)
+void setPTT(Channel &c, byte b)
 {
 
   if (b)
   { // PTT ON
-    if (mode == FSK_MODE) {
-      digitalWrite(FSK_PIN, mark);  //always start in mark state
-      digitalWrite(PTT_PIN, HIGH);
-      // we will stay in the mark state for some amount of time
-      // before sending the first start bit of the first character
-      delay(pttLeadMillis);
-    } else
-      digitalWrite(PTT_PIN, HIGH);
+    if (c.mode == FSK_MODE) {
+      if (c.ptt) return;  // already clocking out characters
+      resetChar(c);
+      fsk_line(c.n, c.mark, 0);  //always start in mark state
+    }
+    c.pttSeq.hold(PTT_HOST, true);
   }
   else
   { // PTT OFF
-    if (mode == FSK_MODE) {
-      digitalWrite(PTT_PIN, LOW); // drop PTT
-      digitalWrite(FSK_PIN, space);
-      digitalWrite(CW_PIN, LOW);
-      delay (pttTailMillis);
-      stopBitCounter = 0;
-      bitPos = -1;
-      currentShiftState = SHIFT_UNKNOWN;
-      lastAsciiByteSent = 0;
+    c.ptt = false;  // stop the half-bit interrupt first
+    c.tuneKey = false;
+    c.pttSeq.hold(PTT_HOST, false);
+    if (c.mode == FSK_MODE) {
+      resetChar(c);              // mark until PTT drops, see cw_tick()
     } else {
-      digitalWrite(PTT_PIN, LOW);
-      digitalWrite(CW_PIN, LOW);
+      cw_line(c.n, LOW, 0);
     }
-    Serial.write("\ncmd:\n"); // Tells N1MM that TX is finished
+    cmdReplies++;  // the loop tells N1MM that TX is finished
   }
-  ptt = b;
+  c.ptt = b;
 }
 
-void enable_tune()
+/**
+  Key down with PTT on until ] or an abort.  The key goes down once
+  the lead time is up.
+*/
+void enable_tune(Channel &c)
 {
-  digitalWrite(PTT_PIN, HIGH);
-  digitalWrite(CW_PIN, HIGH);
+  c.pttSeq.hold(PTT_HOST, true);
+  c.tuneKey = true;
 }
 
 /**
   Echo to the serial port.  This will show up in the user's terminal
-  if he or she is watching.
+  if he or she is watching.  It is queued, never waited for.
 */
 void echo(byte b)
 {
-  Serial.write(b);
+  hostOut.write(b);
 }
 
@@ -0,0 +1,64 @@
+// Host-side stand-in for the Arduino core, see sim.cpp
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define _BV(bit) (1 << (bit))
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#include "avr/io.h"
+#include "avr/interrupt.h"
+#include "avr/pgmspace.h"
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+inline void noInterrupts() { cli(); }
+inline void interrupts() { sei(); }
+
+#include "Print.h"
+
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+#define SERIAL_RX_BUFFER_SIZE 64
+
+class HardwareSerial : public Print
+{
+public:
+	void begin(unsigned long baud);
+	void end() {}
+	int available(void);
+	int peek(void);
+	int read(void);
+	virtual int availableForWrite(void);
+	virtual void flush(void);
+	virtual size_t write(uint8_t c);
+	using Print::write;
+	operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
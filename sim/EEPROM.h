@@ -0,0 +1,40 @@
+// Host-side stand-in for the EEPROM library.  Writes take the same
+// 3.3 msec of virtual time they take on the ATmega328P, and as there
+// the next write (not the current one) waits for it.
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define SIM_EEPROM_SIZE 1024
+
+void sim_eeprom_write(int idx, uint8_t val);
+bool eeprom_is_ready();   // from <avr/eeprom.h> on the target
+
+struct EEPROMClass
+{
+	uint8_t mem[SIM_EEPROM_SIZE];
+
+	uint8_t read(int idx) { return mem[idx]; }
+	void write(int idx, uint8_t val) { sim_eeprom_write(idx, val); }
+	void update(int idx, uint8_t val) { if (mem[idx] != val) write(idx, val); }
+	uint16_t length() { return SIM_EEPROM_SIZE; }
+
+	template <typename T> T &get(int idx, T &t)
+	{
+		memcpy(&t, mem + idx, sizeof(T));
+		return t;
+	}
+	template <typename T> const T &put(int idx, const T &t)
+	{
+		const uint8_t *p = (const uint8_t *)&t;
+		for (size_t i = 0; i < sizeof(T); i++)
+			update(idx + i, p[i]);
+		return t;
+	}
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,31 @@
+// Host-side stand-in for the Arduino core's Print class, see sim.cpp
+#ifndef Print_h
+#define Print_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+class __FlashStringHelper;
+
+class Print
+{
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t *buf, size_t n);
+	size_t write(const char *str);
+	virtual int availableForWrite(void) { return 0; }
+	virtual void flush(void) {}
+
+	size_t print(const char *str) { return write(str); }
+	size_t print(const __FlashStringHelper *str);
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(int n, int base = 10) { return print((long)n, base); }
+	size_t print(unsigned int n, int base = 10) { return print((unsigned long)n, base); }
+	size_t print(long n, int base = 10);
+	size_t print(unsigned long n, int base = 10);
+	size_t print(double n, int digits = 2);
+	size_t println(void) { return write("\r\n"); }
+};
+
+#endif
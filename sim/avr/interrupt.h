@@ -0,0 +1,17 @@
+// Host-side stand-in for <avr/interrupt.h>
+#ifndef sim_avr_interrupt_h
+#define sim_avr_interrupt_h
+
+// Interrupts are never taken asynchronously on the host; sim.cpp only
+// dispatches them from the points where virtual time advances, so the
+// global enable bit just has to be tracked for those checks.
+#define SREG_I 0x80
+
+extern volatile uint8_t SREG;
+
+inline void cli() { SREG &= ~SREG_I; }
+inline void sei() { SREG |= SREG_I; }
+
+#define ISR(vector) extern "C" void vector(void); extern "C" void vector(void)
+
+#endif
@@ -0,0 +1,54 @@
+// Host-side stand-in for <avr/io.h>: the ATmega328P registers nanoIO
+// touches, as plain variables that sim.cpp inspects.
+#ifndef sim_avr_io_h
+#define sim_avr_io_h
+
+#include <stdint.h>
+
+// Digital I/O.  sim.cpp keeps PINx current for inputs and watches
+// PORTx of output pins for edges.
+extern volatile uint8_t PORTB, DDRB, PINB;
+extern volatile uint8_t PORTC, DDRC, PINC;
+extern volatile uint8_t PORTD, DDRD, PIND;
+
+// Pin change interrupts.  sim.cpp sets the PCIFR flag when a script
+// changes an input selected in PCMSKn and calls the vector while the
+// flag and its PCICR enable are both set.
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+
+// Timer1.  sim.cpp derives TCNT1 from the virtual clock, so it can
+// only be read, and calls the compare vectors as the count reaches
+// OCR1A and OCR1B.  Only normal mode is modelled.
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t OCR1A, OCR1B;
+uint16_t sim_tcnt1();
+#define TCNT1 (sim_tcnt1())
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define OCIE1A 1
+#define OCIE1B 2
+#define OCF1A 1
+#define OCF1B 2
+
+// Timer2
+extern volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2, ASSR;
+#define WGM20 0
+#define WGM21 1
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM22 3
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+
+#endif
@@ -0,0 +1,13 @@
+// Host-side stand-in for RamCheck.cpp, which reads the AVR's own RAM
+// layout.  There is none here, so both report 0.
+#include "RamCheck.h"
+
+unsigned int ram_free()
+{
+	return 0;
+}
+
+unsigned int stack_unused()
+{
+	return 0;
+}
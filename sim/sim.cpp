@@ -0,0 +1,713 @@
+//**********************************************************************
+//
+// sim, host-side test bench for nanoIO
+//
+// Copyright (C) 2018, David Freese, W1HKJ
+//
+// nanoIO is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// nanoIO is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//
+//**********************************************************************
+//
+// Runs the unmodified sketch against a virtual microsecond clock.
+//
+// Time only moves when the sketch lets it: each pass through loop()
+// costs a fixed number of microseconds, delay() and blocking serial
+// writes advance the clock, and an EEPROM write keeps the next one
+// waiting 3.3 msec.  Timer
+// and serial receive interrupts are dispatched in time order whenever
+// the clock moves and interrupts are enabled, so every run of a given
+// script produces the same trace.
+//
+// usage: nanoIO_sim [-t msec] [-l usec] [-a] [-v] [-e file] [script]
+//
+//   -t  stop after this many msec of virtual time (default 10000)
+//   -l  cost of one pass through loop() in usec (default 20)
+//   -a  trace every output pin, not only FSK, CW and PTT
+//   -v  also trace serial bytes in (RX) and out (TX)
+//   -e  EEPROM image, loaded at start if it exists and saved at the
+//       end, so a second run sees what the first one wrote
+//
+// Script lines (read from stdin without a file name), times in msec:
+//
+//   <time> send <text>       host sends text; \n \r \\ \xNN escapes
+//   <time> pin <n> <0|1>     drive input pin n, e.g. a paddle contact
+//   0 eeprom <addr> <hex>... put bytes in the EEPROM before setup() runs,
+//                            e.g. an image saved by an earlier version
+//   <time> end               stop the run
+//
+// Output, one line per event, is "<usec> <signal> <value>".
+//
+//**********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <deque>
+#include <vector>
+
+#include "Arduino.h"
+#include "EEPROM.h"
+
+#include "config.h"
+
+void setup();
+void loop();
+
+extern "C" void TIMER1_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER1_COMPB_vect(void) __attribute__((weak));
+extern "C" void TIMER2_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER2_OVF_vect(void) __attribute__((weak));
+extern "C" void PCINT0_vect(void) __attribute__((weak));
+extern "C" void PCINT1_vect(void) __attribute__((weak));
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+
+//----------------------------------------------------------------------
+// virtual time and interrupt dispatch
+//----------------------------------------------------------------------
+
+static uint64_t now_us = 0;
+static uint64_t end_us = 10000000ULL;
+static unsigned long loop_cost_us = 20;
+static bool trace_all = false;
+static bool trace_serial = false;
+static bool in_isr = false;
+
+volatile uint8_t SREG = SREG_I;
+volatile uint8_t PORTB, DDRB, PINB;
+volatile uint8_t PORTC, DDRC, PINC;
+volatile uint8_t PORTD, DDRD, PIND;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t OCR1A, OCR1B;
+volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2, ASSR;
+volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+
+EEPROMClass EEPROM;
+HardwareSerial Serial;
+
+static const unsigned long CLOCKS_PER_US = F_CPU / 1000000UL;
+static bool t1_running = false;
+static uint64_t t1_zero_clk = 0;        // CPU clock Timer1 started counting from 0
+
+// A Timer1 compare unit and the CPU clock of its next match
+struct T1Compare {
+	volatile uint16_t *ocr;
+	uint8_t ie;
+	void (*vect)();
+	bool armed;
+	uint16_t seen;          // the OCR value next_clk was worked out for
+	uint64_t next_clk;
+};
+static T1Compare t1_cmp[2] = {
+	{ &OCR1A, _BV(OCIE1A), TIMER1_COMPA_vect, false, 0, 0 },
+	{ &OCR1B, _BV(OCIE1B), TIMER1_COMPB_vect, false, 0, 0 },
+};
+static uint64_t t2_next_clk = 0;        // CPU clock of the next Timer2 interrupt
+static bool t2_armed = false;
+
+struct RxByte { uint64_t at; uint8_t b; };
+static std::deque<RxByte> rx_pending;   // not yet received, by send time
+static uint64_t rx_wire_free = 0;       // end of the last byte received
+static std::deque<uint8_t> rx_fifo;     // the core's 64 byte buffer
+static unsigned long rx_overruns = 0;
+static const size_t RX_FIFO_SIZE = SERIAL_RX_BUFFER_SIZE;
+
+static std::deque<uint64_t> tx_fifo;    // completion time of queued bytes
+static const size_t TX_FIFO_SIZE = 64;
+static unsigned long serial_baud = 9600;
+
+struct PinEvent { uint64_t at; uint8_t pin; uint8_t level; };
+static std::deque<PinEvent> pin_events;
+
+static const int NUM_PINS = 20;
+static uint8_t pin_traced[NUM_PINS];    // last output level reported
+static uint8_t pin_in[NUM_PINS];        // externally driven level
+static bool pin_driven[NUM_PINS];
+
+static unsigned long byte_time_us()
+{
+	return 10000000UL / serial_baud;
+}
+
+// Timer1 prescale in normal mode, 0 if it is stopped or in another mode
+static unsigned int timer1_prescale()
+{
+	static const unsigned int prescale[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+	if ((TCCR1A & 0x03) || (TCCR1B & 0x18))
+		return 0;
+	return prescale[TCCR1B & 0x07];
+}
+
+// Timer1 count at a CPU clock.  It starts from 0 when the timer is
+// first given a clock and is never reset.
+static uint16_t timer1_count(uint64_t clk)
+{
+	unsigned int ps = timer1_prescale();
+	if (!ps)
+		return 0;
+	if (!t1_running) {
+		t1_running = true;
+		t1_zero_clk = clk;
+	}
+	return (uint16_t)((clk - t1_zero_clk) / ps);
+}
+
+uint16_t sim_tcnt1()
+{
+	return timer1_count(now_us * CLOCKS_PER_US);
+}
+
+// Steps from one compare value to the next match, a whole turn if equal
+static uint64_t timer1_steps(uint16_t from, uint16_t to)
+{
+	uint16_t d = to - from;
+	return d ? d : 65536;
+}
+
+// Timer2 interrupt period in CPU clocks and its vector, 0 if none: CTC
+// with the compare A interrupt, or phase correct PWM to 0xFF with the
+// overflow interrupt
+static unsigned long timer2_period(void (**vect)())
+{
+	static const unsigned int prescale[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+	unsigned int ps = prescale[TCCR2B & 0x07];
+	uint8_t wgm = (TCCR2A & (_BV(WGM21) | _BV(WGM20))) | (TCCR2B & _BV(WGM22));
+	if (!ps)
+		return 0;
+	if (wgm == _BV(WGM21) && (TIMSK2 & _BV(OCIE2A)) && TIMER2_COMPA_vect) {
+		*vect = TIMER2_COMPA_vect;
+		return (unsigned long)(OCR2A + 1) * ps;
+	}
+	if (wgm == _BV(WGM20) && (TIMSK2 & _BV(TOIE2)) && TIMER2_OVF_vect) {
+		*vect = TIMER2_OVF_vect;
+		return 510UL * ps;
+	}
+	return 0;
+}
+
+// A byte sent at 'at' arrives one character time after both it was
+// sent and the byte before it finished arriving
+static uint64_t rx_arrival()
+{
+	uint64_t t = rx_pending.front().at;
+	if (t < rx_wire_free)
+		t = rx_wire_free;
+	return t + byte_time_us();
+}
+
+static void trace(const char *sig, unsigned long val)
+{
+	printf("%12llu %-6s %lu\n", (unsigned long long)now_us, sig, val);
+}
+
+static const char *pin_name(uint8_t pin)
+{
+	static char buf[8];
+	if (pin == FSK_PIN && pin == CW_PIN) return "FSK/CW";
+	if (pin == FSK_PIN) return "FSK";
+	if (pin == CW_PIN) return "CW";
+	if (pin == PTT_PIN) return "PTT";
+#ifdef SO2R
+	if (pin == FSK2_PIN && pin == CW2_PIN) return "FSK2/CW2";
+	if (pin == FSK2_PIN) return "FSK2";
+	if (pin == CW2_PIN) return "CW2";
+	if (pin == PTT2_PIN) return "PTT2";
+#endif
+	if (!trace_all) return 0;
+	snprintf(buf, sizeof(buf), "D%d", pin);
+	return buf;
+}
+
+//----------------------------------------------------------------------
+// pins: D0..D7 PORTD, D8..D13 PORTB, A0..A5 PORTC
+//----------------------------------------------------------------------
+
+static volatile uint8_t &port_reg(uint8_t pin)
+{
+	return pin < 8 ? PORTD : pin < 14 ? PORTB : PORTC;
+}
+
+static volatile uint8_t &ddr_reg(uint8_t pin)
+{
+	return pin < 8 ? DDRD : pin < 14 ? DDRB : DDRC;
+}
+
+static volatile uint8_t &pin_reg(uint8_t pin)
+{
+	return pin < 8 ? PIND : pin < 14 ? PINB : PINC;
+}
+
+static uint8_t pin_bit(uint8_t pin)
+{
+	return _BV(pin < 8 ? pin : pin < 14 ? pin - 8 : pin - 14);
+}
+
+static volatile uint8_t &pcmsk_reg(uint8_t pin)
+{
+	return pin < 8 ? PCMSK2 : pin < 14 ? PCMSK0 : PCMSK1;
+}
+
+static uint8_t pcie_bit(uint8_t pin)
+{
+	return _BV(pin < 8 ? PCIE2 : pin < 14 ? PCIE0 : PCIE1);
+}
+
+// Outputs read back what is driven; inputs read the level the script
+// last put on them, or the pull-up if nothing has.
+static void sync_inputs()
+{
+	for (uint8_t pin = 0; pin < NUM_PINS; pin++) {
+		uint8_t m = pin_bit(pin);
+		bool level;
+		if ((ddr_reg(pin) & m) || !pin_driven[pin])
+			level = port_reg(pin) & m;
+		else
+			level = pin_in[pin];
+		if (level)
+			pin_reg(pin) |= m;
+		else
+			pin_reg(pin) &= ~m;
+	}
+}
+
+// Report output pins that changed since the last look.  This is called
+// after every piece of sketch code runs; the clock does not move while
+// it runs, so each edge gets the exact virtual time it was written at.
+static void scan_outputs()
+{
+	for (uint8_t pin = 0; pin < NUM_PINS; pin++) {
+		uint8_t m = pin_bit(pin);
+		if (!(ddr_reg(pin) & m))
+			continue;
+		uint8_t level = (port_reg(pin) & m) ? HIGH : LOW;
+		if (level == pin_traced[pin])
+			continue;
+		pin_traced[pin] = level;
+		const char *name = pin_name(pin);
+		if (name)
+			trace(name, level);
+	}
+	sync_inputs();
+}
+
+static void run_isr(void (*isr)())
+{
+	scan_outputs();
+	in_isr = true;
+	SREG &= ~SREG_I;
+	isr();
+	SREG |= SREG_I;
+	in_isr = false;
+	scan_outputs();
+}
+
+// Move the clock forward to 'until', taking every interrupt that falls
+// due on the way.  Nothing is taken while the sketch has them masked
+// or while an ISR is already running.
+static void advance_to(uint64_t until)
+{
+	scan_outputs();
+	for (;;) {
+		uint64_t next = until;
+
+		// a compare set outside its interrupt matches when the count
+		// next gets there
+		unsigned int ps1 = timer1_prescale();
+		T1Compare *t1 = 0;      // the one due first
+		for (T1Compare &c : t1_cmp) {
+			if (!ps1 || !(TIMSK1 & c.ie) || !c.vect) {
+				c.armed = false;
+				continue;
+			}
+			if (!c.armed || *c.ocr != c.seen) {
+				uint64_t clk = now_us * CLOCKS_PER_US;
+				uint64_t steps = timer1_steps(timer1_count(clk), *c.ocr);
+				c.next_clk = t1_zero_clk + ((clk - t1_zero_clk) / ps1 + steps) * ps1;
+				c.seen = *c.ocr;
+				c.armed = true;
+			}
+			if (!t1 || c.next_clk < t1->next_clk)
+				t1 = &c;
+		}
+		uint64_t t1_next = t1 ? (t1->next_clk + CLOCKS_PER_US - 1) / CLOCKS_PER_US : 0;
+
+		void (*v2)() = 0;
+		unsigned long p2 = timer2_period(&v2);
+		if (!p2)
+			t2_armed = false;
+		else if (!t2_armed) {
+			t2_armed = true;
+			t2_next_clk = now_us * CLOCKS_PER_US + p2;
+		}
+		// taken at the first whole usec at or after it falls due
+		uint64_t t2_next = (t2_next_clk + CLOCKS_PER_US - 1) / CLOCKS_PER_US;
+
+		// pending interrupts wait until they are unmasked
+		bool can_isr = (SREG & SREG_I) && !in_isr;
+
+		// pin change interrupts come first, in vector order
+		uint8_t pc = PCIFR & PCICR;
+		if (can_isr && pc) {
+			static void (* const vect[3])() = { PCINT0_vect, PCINT1_vect, PCINT2_vect };
+			uint8_t n = (pc & _BV(PCIE0)) ? 0 : (pc & _BV(PCIE1)) ? 1 : 2;
+			PCIFR &= ~_BV(n);
+			if (vect[n])
+				run_isr(vect[n]);
+			continue;
+		}
+
+		if (can_isr && t1 && t1_next < next)
+			next = t1_next;
+		if (can_isr && t2_armed && t2_next < next)
+			next = t2_next;
+		if (can_isr && !rx_pending.empty() && rx_arrival() < next)
+			next = rx_arrival();
+		if (!pin_events.empty() && pin_events.front().at < next)
+			next = pin_events.front().at;
+
+		if (next > now_us)
+			now_us = next;
+
+		while (!tx_fifo.empty() && tx_fifo.front() <= now_us)
+			tx_fifo.pop_front();
+
+		if (!pin_events.empty() && pin_events.front().at <= now_us) {
+			PinEvent e = pin_events.front();
+			pin_events.pop_front();
+			uint8_t was = pin_reg(e.pin) & pin_bit(e.pin);
+			pin_in[e.pin] = e.level;
+			pin_driven[e.pin] = true;
+			sync_inputs();
+			if ((pin_reg(e.pin) & pin_bit(e.pin)) != was &&
+			    (pcmsk_reg(e.pin) & pin_bit(e.pin)))
+				PCIFR |= pcie_bit(e.pin);
+			if (trace_serial || trace_all) {
+				char sig[8];
+				snprintf(sig, sizeof(sig), "IN%d", e.pin);
+				trace(sig, e.level);
+			}
+			continue;
+		}
+		if (can_isr && !rx_pending.empty() && rx_arrival() <= now_us) {
+			RxByte r = rx_pending.front();
+			rx_wire_free = rx_arrival();
+			rx_pending.pop_front();
+			if (rx_fifo.size() < RX_FIFO_SIZE)
+				rx_fifo.push_back(r.b);
+			else
+				rx_overruns++;
+			if (trace_serial)
+				trace("RX", r.b);
+			continue;
+		}
+		if (can_isr && t1 && t1_next <= now_us) {
+			// the ISR moves the compare on from the match
+			run_isr(t1->vect);
+			t1->next_clk += timer1_steps(t1->seen, *t1->ocr) * ps1;
+			t1->seen = *t1->ocr;
+			continue;
+		}
+		if (can_isr && t2_armed && t2_next <= now_us) {
+			t2_next_clk += p2;
+			run_isr(v2);
+			continue;
+		}
+		if (now_us >= until)
+			return;
+	}
+}
+
+static void advance(unsigned long us)
+{
+	advance_to(now_us + us);
+}
+
+//----------------------------------------------------------------------
+// Arduino core
+//----------------------------------------------------------------------
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	uint8_t m = pin_bit(pin);
+	if (mode == OUTPUT)
+		ddr_reg(pin) |= m;
+	else
+		ddr_reg(pin) &= ~m;
+	if (mode == INPUT_PULLUP)
+		port_reg(pin) |= m;
+	else if (mode == INPUT)
+		port_reg(pin) &= ~m;
+	sync_inputs();
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	uint8_t m = pin_bit(pin);
+	if (val)
+		port_reg(pin) |= m;
+	else
+		port_reg(pin) &= ~m;
+	sync_inputs();
+}
+
+int digitalRead(uint8_t pin)
+{
+	sync_inputs();
+	return (pin_reg(pin) & pin_bit(pin)) ? HIGH : LOW;
+}
+
+unsigned long millis(void)
+{
+	return (unsigned long)(now_us / 1000);
+}
+
+unsigned long micros(void)
+{
+	return (unsigned long)now_us;
+}
+
+void delay(unsigned long ms)
+{
+	advance(ms * 1000UL);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	advance(us);
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+	serial_baud = baud;
+}
+
+int HardwareSerial::available(void)
+{
+	return rx_fifo.size();
+}
+
+int HardwareSerial::peek(void)
+{
+	return rx_fifo.empty() ? -1 : rx_fifo.front();
+}
+
+int HardwareSerial::read(void)
+{
+	if (rx_fifo.empty())
+		return -1;
+	int b = rx_fifo.front();
+	rx_fifo.pop_front();
+	return b;
+}
+
+int HardwareSerial::availableForWrite(void)
+{
+	return TX_FIFO_SIZE - 1 - tx_fifo.size();
+}
+
+void HardwareSerial::flush(void)
+{
+	if (!tx_fifo.empty())
+		advance_to(tx_fifo.back());
+}
+
+// Like the AVR core, a write blocks only once the TX buffer is full
+size_t HardwareSerial::write(uint8_t c)
+{
+	while (tx_fifo.size() >= TX_FIFO_SIZE - 1)
+		advance_to(tx_fifo.front());
+	uint64_t start = tx_fifo.empty() ? now_us : tx_fifo.back();
+	tx_fifo.push_back(start + byte_time_us());
+	if (trace_serial)
+		trace("TX", c);
+	else
+		fputc(c, stderr);
+	return 1;
+}
+
+size_t Print::write(const uint8_t *buf, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		write(buf[i]);
+	return n;
+}
+
+size_t Print::write(const char *str)
+{
+	return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::print(const __FlashStringHelper *str)
+{
+	return write((const char *)str);
+}
+
+size_t Print::print(long n, int base)
+{
+	char buf[24];
+	snprintf(buf, sizeof(buf), base == 16 ? "%lX" : "%ld", n);
+	return write(buf);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+	char buf[24];
+	snprintf(buf, sizeof(buf), base == 16 ? "%lX" : "%lu", n);
+	return write(buf);
+}
+
+size_t Print::print(double n, int digits)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return write(buf);
+}
+
+// Like avr-libc, a write waits for the one before it to finish, then
+// starts and returns; the cell takes 3.3 msec to program.
+static uint64_t eeprom_busy_until = 0;
+
+void sim_eeprom_write(int idx, uint8_t val)
+{
+	if (now_us < eeprom_busy_until)
+		advance_to(eeprom_busy_until);
+	EEPROM.mem[idx] = val;
+	eeprom_busy_until = now_us + 3300;
+}
+
+bool eeprom_is_ready()
+{
+	return now_us >= eeprom_busy_until;
+}
+
+//----------------------------------------------------------------------
+// script
+//----------------------------------------------------------------------
+
+static void add_text(uint64_t at, const char *p)
+{
+	while (*p) {
+		int c = (unsigned char)*p++;
+		if (c == '\\' && *p) {
+			switch (*p++) {
+				case 'n' : c = '\n'; break;
+				case 'r' : c = '\r'; break;
+				case 'x' : c = strtol(p, (char **)&p, 16); break;
+				default  : c = p[-1]; break;
+			}
+		}
+		RxByte r = { at, (uint8_t)c };
+		rx_pending.push_back(r);
+	}
+}
+
+static void load_script(FILE *f)
+{
+	char line[512];
+	int n = 0;
+	while (fgets(line, sizeof(line), f)) {
+		n++;
+		char *p = line + strspn(line, " \t");
+		if (*p == '#' || *p == '\n' || !*p)
+			continue;
+		line[strcspn(line, "\r\n")] = 0;
+		char *cmd;
+		double ms = strtod(p, &cmd);
+		uint64_t at = (uint64_t)(ms * 1000);
+		cmd += strspn(cmd, " \t");
+		if (strncmp(cmd, "send ", 5) == 0)
+			add_text(at, cmd + 5);
+		else if (strncmp(cmd, "pin ", 4) == 0) {
+			int pin = 0, level = 0;
+			sscanf(cmd + 4, "%d %d", &pin, &level);
+			PinEvent e = { at, (uint8_t)pin, (uint8_t)(level ? HIGH : LOW) };
+			pin_events.push_back(e);
+		}
+		else if (strncmp(cmd, "eeprom ", 7) == 0) {
+			char *q = cmd + 7;
+			unsigned long addr = strtoul(q, &q, 10);
+			for (char *e; addr < sizeof(EEPROM.mem); q = e, addr++) {
+				unsigned long b = strtoul(q, &e, 16);
+				if (e == q)
+					break;
+				EEPROM.mem[addr] = (uint8_t)b;
+			}
+		}
+		else if (strncmp(cmd, "end", 3) == 0)
+			end_us = at;
+		else
+			fprintf(stderr, "script line %d: unknown command\n", n);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+	const char *eeprom_file = 0;
+	while ((opt = getopt(argc, argv, "t:l:ave:")) != -1) {
+		switch (opt) {
+			case 't' : end_us = (uint64_t)(atof(optarg) * 1000); break;
+			case 'l' : loop_cost_us = strtoul(optarg, 0, 10); break;
+			case 'a' : trace_all = true; break;
+			case 'v' : trace_serial = true; break;
+			case 'e' : eeprom_file = optarg; break;
+			default :
+				fprintf(stderr, "usage: %s [-t msec] [-l usec] [-a] [-v] [-e file] [script]\n", argv[0]);
+				return 1;
+		}
+	}
+	// erased EEPROM reads back as 0xFF
+	memset(EEPROM.mem, 0xFF, sizeof(EEPROM.mem));
+	if (eeprom_file) {
+		FILE *f = fopen(eeprom_file, "rb");
+		if (f) {
+			if (fread(EEPROM.mem, 1, sizeof(EEPROM.mem), f) != sizeof(EEPROM.mem))
+				fprintf(stderr, "%s: short EEPROM image\n", eeprom_file);
+			fclose(f);
+		}
+	}
+
+	if (optind < argc) {
+		FILE *f = fopen(argv[optind], "r");
+		if (!f) {
+			perror(argv[optind]);
+			return 1;
+		}
+		load_script(f);
+		fclose(f);
+	} else
+		load_script(stdin);
+
+	// serial timing depends on the rate the sketch opens the port at
+	sync_inputs();
+	setup();
+	while (now_us < end_us) {
+		loop();
+		advance(loop_cost_us);
+	}
+	scan_outputs();
+	if (rx_overruns)
+		fprintf(stderr, "\n%lu serial receive overruns\n", rx_overruns);
+	if (eeprom_file) {
+		FILE *f = fopen(eeprom_file, "wb");
+		if (!f) {
+			perror(eeprom_file);
+			return 1;
+		}
+		fwrite(EEPROM.mem, 1, sizeof(EEPROM.mem), f);
+		fclose(f);
+	}
+	return 0;
+}